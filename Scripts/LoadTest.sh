@@ -0,0 +1,46 @@
+#!/usr/bin/env bash
+# Starts a headless dedicated server on NetworkTesting and N bot clients over loopback, then stops everything
+# after the given duration. The server writes its samples to a CSV file through ULoadTestSubsystem.
+#
+# Usage: Scripts/LoadTest.sh <NumBots> [DurationSeconds] [Csv]
+#
+# SERVER_BIN and CLIENT_BIN default to a Linux package staged by:
+#   RunUAT.sh BuildCookRun -project=Capstone.uproject -platform=Linux -server -serverplatform=Linux -servertarget=CapstoneServer -build -cook -stage -pak
+set -euo pipefail
+
+NUM_BOTS=${1:?"Usage: $0 <NumBots> [DurationSeconds] [Csv]"}
+DURATION=${2:-120}
+CSV=${3:-"$PWD/LoadTest-${NUM_BOTS}bots.csv"}
+PORT=${PORT:-7777}
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+SERVER_BIN=${SERVER_BIN:-"$ROOT/Saved/StagedBuilds/LinuxServer/Capstone/Binaries/Linux/CapstoneServer"}
+CLIENT_BIN=${CLIENT_BIN:-"$ROOT/Saved/StagedBuilds/Linux/Capstone/Binaries/Linux/Capstone"}
+
+# Steam is off so the net driver falls back to the IpNetDriver
+NO_STEAM="-ini:Engine:[OnlineSubsystem]:DefaultPlatformService=Null,[OnlineSubsystemSteam]:bEnabled=False"
+
+mkdir -p "$ROOT/Saved"
+
+PIDS=()
+cleanup()
+{
+	for PID in "${PIDS[@]}"; do kill -INT "$PID" 2>/dev/null || true; done
+	wait
+}
+trap cleanup EXIT
+
+"$SERVER_BIN" /Game/Maps/NetworkTesting -server -nullrhi -nosound -unattended -log -port="$PORT" \
+	-LoadTest -LoadTestCsv="$CSV" "$NO_STEAM" > "$ROOT/Saved/LoadTest-Server.log" 2>&1 &
+PIDS+=($!)
+sleep 10
+
+for (( i = 0; i < NUM_BOTS; i++ )); do
+	"$CLIENT_BIN" 127.0.0.1:"$PORT" -game -nullrhi -nosound -unattended -log \
+		-LoadTestBot -LoadTestSeed="$i" "$NO_STEAM" > "$ROOT/Saved/LoadTest-Bot$i.log" 2>&1 &
+	PIDS+=($!)
+	sleep 0.5
+done
+
+echo "Running $NUM_BOTS bots for $DURATION seconds, samples go to $CSV"
+sleep "$DURATION"
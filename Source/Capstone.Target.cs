@@ -10,6 +10,7 @@ public class CapstoneTarget : TargetRules
 		Type = TargetType.Game;
 		DefaultBuildSettings = BuildSettingsVersion.V4;
 		IncludeOrderVersion = EngineIncludeOrderVersion.Unreal5_3;
+		bWithPushModel = true;
 		bUsesSteam = true;
 		ExtraModuleNames.Add("Capstone");
 	}
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AggregatedTickSubsystem.h"
+#include "Weapon.h"
+#include "NetworkProjectile.h"
+#include "CapstoneStats.h"
+
+bool UAggregatedTickSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UAggregatedTickSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT( UAggregatedTickSubsystem, STATGROUP_Tickables );
+}
+
+void UAggregatedTickSubsystem::RegisterRecoil( AWeapon* Weapon )
+{
+	RecoilWeapons.AddUnique( Weapon );
+}
+
+void UAggregatedTickSubsystem::UnregisterWeapon( AWeapon* Weapon )
+{
+	RecoilWeapons.RemoveSwap( Weapon );
+}
+
+void UAggregatedTickSubsystem::RegisterHoming( ANetworkProjectile* Projectile )
+{
+	HomingProjectiles.AddUnique( Projectile );
+}
+
+void UAggregatedTickSubsystem::UnregisterProjectile( ANetworkProjectile* Projectile )
+{
+	HomingProjectiles.RemoveSwap( Projectile );
+}
+
+void UAggregatedTickSubsystem::Tick( float DeltaTime )
+{
+	SET_DWORD_STAT( STAT_AggregatedTickWeapons, RecoilWeapons.Num() );
+	SET_DWORD_STAT( STAT_AggregatedTickProjectiles, HomingProjectiles.Num() );
+
+	// Back to front so finished entries can be swapped out while iterating
+	for ( int32 Index = RecoilWeapons.Num() - 1; Index >= 0; --Index )
+	{
+		AWeapon* Weapon = RecoilWeapons[Index];
+		if ( !IsValid( Weapon ) || !Weapon->RecoverRecoil( DeltaTime ) ) RecoilWeapons.RemoveAtSwap( Index, 1, false );
+	}
+
+	for ( int32 Index = HomingProjectiles.Num() - 1; Index >= 0; --Index )
+	{
+		ANetworkProjectile* Projectile = HomingProjectiles[Index];
+		if ( !IsValid( Projectile ) || !Projectile->UpdateHoming( DeltaTime ) ) HomingProjectiles.RemoveAtSwap( Index, 1, false );
+	}
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "AggregatedTickSubsystem.generated.h"
+
+class AWeapon;
+class ANetworkProjectile;
+
+/**
+ * Ticks weapons and projectiles in one tight loop per kind instead of through an actor tick function each.
+ * AWeapon and ANetworkProjectile never tick on their own; they register here only while they have per-frame work
+ * (recoil recovery, homing) and drop out as soon as it is done, so an idle actor costs nothing.
+ */
+UCLASS()
+class CAPSTONE_API UAggregatedTickSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Recovers Weapon's recoil every frame until it has settled. Registering a weapon twice is harmless.*/
+	void RegisterRecoil( AWeapon* Weapon );
+	void UnregisterWeapon( AWeapon* Weapon );
+
+	/** Steers Projectile every frame until it loses its target or is unregistered.*/
+	void RegisterHoming( ANetworkProjectile* Projectile );
+	void UnregisterProjectile( ANetworkProjectile* Projectile );
+
+	virtual void Tick( float DeltaTime ) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	UPROPERTY()
+	TArray<AWeapon*> RecoilWeapons;
+
+	UPROPERTY()
+	TArray<ANetworkProjectile*> HomingProjectiles;
+};
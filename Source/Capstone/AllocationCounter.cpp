@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AllocationCounter.h"
+
+// Forwards everything to the real allocator, counting allocations made by the game thread on the way
+class FCountingMalloc final : public FMalloc
+{
+public:
+	explicit FCountingMalloc( FMalloc* InInner ) : Inner( InInner ) {}
+
+	uint64 GetCount() const { return Count.load( std::memory_order_relaxed ); }
+
+	virtual void* Malloc( SIZE_T Size, uint32 Alignment ) override { Record(); return Inner->Malloc( Size, Alignment ); }
+	virtual void* TryMalloc( SIZE_T Size, uint32 Alignment ) override { Record(); return Inner->TryMalloc( Size, Alignment ); }
+	virtual void* Realloc( void* Original, SIZE_T Size, uint32 Alignment ) override { Record(); return Inner->Realloc( Original, Size, Alignment ); }
+	virtual void* TryRealloc( void* Original, SIZE_T Size, uint32 Alignment ) override { Record(); return Inner->TryRealloc( Original, Size, Alignment ); }
+	virtual void Free( void* Original ) override { Inner->Free( Original ); }
+
+	virtual SIZE_T QuantizeSize( SIZE_T Size, uint32 Alignment ) override { return Inner->QuantizeSize( Size, Alignment ); }
+	virtual bool GetAllocationSize( void* Original, SIZE_T& SizeOut ) override { return Inner->GetAllocationSize( Original, SizeOut ); }
+	virtual void Trim( bool bTrimThreadCaches ) override { Inner->Trim( bTrimThreadCaches ); }
+	virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void MarkTLSCachesAsUsedOnCurrentThread() override { Inner->MarkTLSCachesAsUsedOnCurrentThread(); }
+	virtual void MarkTLSCachesAsUnusedOnCurrentThread() override { Inner->MarkTLSCachesAsUnusedOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void InitializeStatsMetadata() override { Inner->InitializeStatsMetadata(); }
+	virtual void UpdateStats() override { Inner->UpdateStats(); }
+	virtual void GetAllocatorStats( FGenericMemoryStats& OutStats ) override { Inner->GetAllocatorStats( OutStats ); }
+	virtual void DumpAllocatorStats( FOutputDevice& Ar ) override { Inner->DumpAllocatorStats( Ar ); }
+	virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+private:
+	FORCEINLINE void Record()
+	{
+		if ( IsInGameThread() ) Count.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	FMalloc* Inner;
+	std::atomic<uint64> Count { 0 };
+};
+
+// Other threads may still be inside the proxy for a moment after a scope ends, so it lives until exit
+static FCountingMalloc& GetCountingMalloc()
+{
+	static FCountingMalloc Proxy( GMalloc );
+	return Proxy;
+}
+
+// Open scopes, and the allocator the outermost one replaced. Only touched by the game thread
+static int32 GScopeDepth = 0;
+static FMalloc* GPreviousMalloc = nullptr;
+
+FScopedAllocationCounter::FScopedAllocationCounter()
+{
+	check( IsInGameThread() );
+
+	Proxy = &GetCountingMalloc();
+	if ( GScopeDepth++ == 0 )
+	{
+		check( GMalloc != Proxy );
+		GPreviousMalloc = GMalloc;
+		GMalloc = Proxy;
+	}
+
+	StartCount = Proxy->GetCount();
+}
+
+FScopedAllocationCounter::~FScopedAllocationCounter()
+{
+	check( GScopeDepth > 0 );
+	if ( --GScopeDepth > 0 ) return;
+
+	check( GMalloc == Proxy );
+	GMalloc = GPreviousMalloc;
+	GPreviousMalloc = nullptr;
+}
+
+uint64 FScopedAllocationCounter::GetCount() const
+{
+	return Proxy->GetCount() - StartCount;
+}
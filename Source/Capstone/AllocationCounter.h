@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/MemoryBase.h"
+
+#include <atomic>
+
+/**
+ * Counts the heap allocations the game thread makes while it is in scope by putting a forwarding proxy in front of
+ * GMalloc. Meant for short measurements in benchmarks and debug checks, never for shipping code paths.
+ * Scopes may nest, the outermost one installs the proxy and removes it again. They must be created and destroyed on
+ * the game thread.
+ */
+class CAPSTONE_API FScopedAllocationCounter
+{
+public:
+	FScopedAllocationCounter();
+	~FScopedAllocationCounter();
+
+	/** Allocations and reallocations made by the game thread since the scope started.*/
+	uint64 GetCount() const;
+
+private:
+	class FCountingMalloc* Proxy = nullptr;
+	uint64 StartCount = 0;
+};
@@ -2,6 +2,117 @@
 
 #include "Capstone.h"
 #include "Modules/ModuleManager.h"
+#include "CapstoneNetStats.h"
+#include "CapstoneStats.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "Containers/Ticker.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Capstone, "Capstone" );
+DEFINE_STAT( STAT_LoadoutDeltaSerialize );
+DEFINE_STAT( STAT_LoadoutBytesSent );
+DEFINE_STAT( STAT_CharacterDirtyMarks );
+DEFINE_STAT( STAT_ReplicateActors );
+CSV_DEFINE_CATEGORY( CapstoneNet, true );
+DEFINE_STAT( STAT_DamageHitsQueued );
+DEFINE_STAT( STAT_DamageEventsSent );
+DEFINE_STAT( STAT_HitScanImpactsSent );
+DEFINE_STAT( STAT_NetSchedulerUpdate );
+DEFINE_STAT( STAT_NetScheduledActors );
+DEFINE_STAT( STAT_DormantWeapons );
+DEFINE_STAT( STAT_WeaponChannels );
+
+DEFINE_STAT( STAT_WeaponSwaps );
+DEFINE_STAT( STAT_WeaponVisibilityChanges );
+DEFINE_STAT( STAT_WeaponSwapAllocations );
+DEFINE_STAT( STAT_AggregatedTickWeapons );
+DEFINE_STAT( STAT_AggregatedTickProjectiles );
+DEFINE_STAT( STAT_SimulatedRagdolls );
+DEFINE_STAT( STAT_HitScanTraces );
+DEFINE_STAT( STAT_CharacterRespawns );
+DEFINE_STAT( STAT_RespawnObjectsCreated );
+
+DEFINE_STAT( STAT_Equip );
+DEFINE_STAT( STAT_OnRepCurrentWeapon );
+DEFINE_STAT( STAT_WeaponSpawn );
+DEFINE_STAT( STAT_FluidAnimUpdate );
+DEFINE_STAT( STAT_FluidAnimProxyUpdate );
+DEFINE_STAT( STAT_ProjectileImpact );
+DEFINE_STAT( STAT_BatchedProjectileSimulate );
+DEFINE_STAT( STAT_HitScanResolve );
+DEFINE_STAT( STAT_DamageFlush );
+DEFINE_STAT( STAT_CharacterRespawn );
+DEFINE_STAT( STAT_ServerRPC_HandleFire );
+DEFINE_STAT( STAT_ServerRPC_Equip );
+DEFINE_STAT( STAT_ServerRPC_CustomizeWeapon );
+DEFINE_STAT( STAT_ServerRPCsPerSecond );
+DEFINE_STAT( STAT_BytesPerSentRPC );
+
+UE_TRACE_CHANNEL_DEFINE( CapstoneChannel );
+
+TRACE_DECLARE_INT_COUNTER( CapstoneServerRPCsPerSecond, TEXT( "Capstone/Server RPCs Per Second" ) );
+TRACE_DECLARE_INT_COUNTER( CapstoneBytesPerSentRPC, TEXT( "Capstone/Bytes Per Sent RPC" ) );
+
+namespace
+{
+	// RPCs are only ever handled on the game thread, which is also where the core ticker runs
+	struct FRPCWindow
+	{
+		int64 Count = 0;
+		int64 Bits = 0;
+
+		void Reset()
+		{
+			Count = 0;
+			Bits = 0;
+		}
+	};
+
+	FRPCWindow ReceivedRPCs;
+	FRPCWindow SentRPCs;
+
+	// Publishes the rates of the last window, also when nothing arrived in it so they fall back to zero
+	bool PublishRPCRates( const float DeltaTime )
+	{
+		const int64 PerSecond = DeltaTime > 0.0f ? FMath::RoundToInt64( ReceivedRPCs.Count / DeltaTime ) : 0;
+		TRACE_COUNTER_SET( CapstoneServerRPCsPerSecond, PerSecond );
+		SET_DWORD_STAT( STAT_ServerRPCsPerSecond, PerSecond );
+
+		const int64 BytesPerRPC = SentRPCs.Count > 0 ? ( SentRPCs.Bits / SentRPCs.Count + 7 ) / 8 : 0;
+		TRACE_COUNTER_SET( CapstoneBytesPerSentRPC, BytesPerRPC );
+		SET_DWORD_STAT( STAT_BytesPerSentRPC, BytesPerRPC );
+
+		ReceivedRPCs.Reset();
+		SentRPCs.Reset();
+		return true;
+	}
+}
+
+void CapstoneStats::RecordServerRPC()
+{
+	++ReceivedRPCs.Count;
+}
+
+void CapstoneStats::RecordSentRPC( const int64 Bits )
+{
+	++SentRPCs.Count;
+	SentRPCs.Bits += Bits;
+}
+
+class FCapstoneGameModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		RatesTickerHandle = FTSTicker::GetCoreTicker().AddTicker( FTickerDelegate::CreateStatic( &PublishRPCRates ), 1.0f );
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker( RatesTickerHandle );
+	}
+
+private:
+	FTSTicker::FDelegateHandle RatesTickerHandle;
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FCapstoneGameModule, Capstone, "Capstone" );
  
\ No newline at end of file
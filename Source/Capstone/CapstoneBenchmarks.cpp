@@ -0,0 +1,282 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneBenchmarks.h"
+#include "AllocationCounter.h"
+#include "CapstoneCharacter.h"
+#include "FluidAnimInstance.h"
+#include "NetworkProjectile.h"
+#include "ProjectilePoolSubsystem.h"
+#include "Weapon.h"
+
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/Paths.h"
+#include "Serialization/BitWriter.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_LOG_CATEGORY( LogCapstoneBenchmark );
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs CapstoneBenchmarkCommand(
+	TEXT( "Capstone.Benchmark" ),
+	TEXT( "Runs the character, weapon and projectile benchmarks. Usage: Capstone.Benchmark [Iterations] [OutputCsv]" ),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic( &FCapstoneBenchmarks::Run ) );
+
+static FAutoConsoleCommand CapstoneNetSizeReportCommand(
+	TEXT( "Capstone.NetSizeReport" ),
+	TEXT( "Compares full precision and quantized sizes of weapon transforms. Usage: Capstone.NetSizeReport [OutputCsv]" ),
+	FConsoleCommandWithArgsDelegate::CreateStatic( &FCapstoneBenchmarks::NetSizeReport ) );
+#endif
+
+// Runs Body a few times to warm caches, then Iterations times under the clock and the allocation counter
+template<typename FunctionType>
+static FCapstoneBenchmarkResult Measure( const TCHAR* Name, const int32 Iterations, FunctionType&& Body )
+{
+	for ( int32 Index = 0; Index < FMath::Min( Iterations, 10 ); ++Index ) Body( Index );
+
+	FCapstoneBenchmarkResult Result;
+	Result.Name = Name;
+	Result.Iterations = Iterations;
+
+	FScopedAllocationCounter Allocations;
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	for ( int32 Index = 0; Index < Iterations; ++Index ) Body( Index );
+
+	Result.TotalMs = FPlatformTime::ToMilliseconds64( FPlatformTime::Cycles64() - StartCycles );
+	Result.Allocations = Allocations.GetCount();
+	return Result;
+}
+
+void FCapstoneBenchmarks::Run( const TArray<FString>& Args, UWorld* World )
+{
+	const int32 Iterations = Args.Num() > 0 ? FMath::Max( FCString::Atoi( *Args[0] ), 1 ) : 1000;
+	const FString Path = Args.Num() > 1 ? Args[1] : FPaths::ProfilingDir() / TEXT( "Benchmarks" ) / FString::Printf( TEXT( "Capstone-%s.csv" ), *FDateTime::Now().ToString() );
+
+	TArray<FCapstoneBenchmarkResult> Results;
+	if ( !RunAll( World, Iterations, Results ) ) return;
+
+	for ( const FCapstoneBenchmarkResult& Result : Results )
+	{
+		UE_LOG( LogCapstoneBenchmark, Display, TEXT( "%-28s %8d iterations %10.3f ms %8.3f us/iter %8llu allocs" ),
+			*Result.Name, Result.Iterations, Result.TotalMs, Result.TotalMs * 1000.0 / FMath::Max( Result.Iterations, 1 ), Result.Allocations );
+	}
+
+	if ( WriteResults( Results, Path ) ) UE_LOG( LogCapstoneBenchmark, Display, TEXT( "Wrote benchmark results to %s" ), *Path );
+}
+
+bool FCapstoneBenchmarks::RunAll( UWorld* World, const int32 Iterations, TArray<FCapstoneBenchmarkResult>& OutResults )
+{
+	if ( !World || World->GetNetMode() == NM_Client )
+	{
+		UE_LOG( LogCapstoneBenchmark, Error, TEXT( "Benchmarks need a standalone or listen server game world" ) );
+		return false;
+	}
+
+	// Any character works, the benchmarks only need one with weapons
+	ACapstoneCharacter* Character = nullptr;
+	for ( TActorIterator<ACapstoneCharacter> It( World ); It; ++It )
+	{
+		Character = *It;
+		if ( Character->Weapons.Num() > 1 ) break;
+	}
+
+	if ( Character )
+	{
+		OutResults.Add( EquipCycling( Character, Iterations ) );
+		OutResults.Add( WeaponOnRep( Character, Iterations ) );
+	}
+	else
+	{
+		UE_LOG( LogCapstoneBenchmark, Warning, TEXT( "No ACapstoneCharacter in the world, skipping the weapon benchmarks" ) );
+	}
+
+	const TSubclassOf<ANetworkProjectile> ProjectileClass = Character && Character->ProjectileClass ? Character->ProjectileClass : TSubclassOf<ANetworkProjectile>( ANetworkProjectile::StaticClass() );
+	ProjectileSpawnDestroy( World, ProjectileClass, Iterations, OutResults );
+	OutResults.Add( ProjectilePool( World, ProjectileClass, Iterations ) );
+	OutResults.Add( AnimSetVariables( Iterations ) );
+	return true;
+}
+
+FCapstoneBenchmarkResult FCapstoneBenchmarks::EquipCycling( ACapstoneCharacter* Character, const int32 Iterations )
+{
+	// Slots that were never equipped spawn their weapon on the first pass, the warm-up takes that hit
+	const int32 NumWeapons = FMath::Max( Character->Weapons.Num(), 1 );
+	const int32 StartIndex = Character->CurrentIndex;
+
+	// The swap Equip does on the server, without the equip montage which allocates a montage instance every time it plays
+	FCapstoneBenchmarkResult Result = Measure( TEXT( "EquipCycling" ), Iterations, [Character, NumWeapons]( const int32 Index )
+	{
+		Character->EquipSlot( ( Character->CurrentIndex + 1 ) % NumWeapons );
+		Character->ApplyWeaponVisibility();
+	} );
+
+	Character->Equip( StartIndex );
+	return Result;
+}
+
+FCapstoneBenchmarkResult FCapstoneBenchmarks::WeaponOnRep( ACapstoneCharacter* Character, const int32 Iterations )
+{
+	TArray<AWeapon*> Spawned;
+	for ( AWeapon* Weapon : Character->Weapons )
+	{
+		if ( Weapon ) Spawned.Add( Weapon );
+	}
+
+	AWeapon* const StartWeapon = Character->CurrentWeapon;
+	if ( Spawned.Num() == 0 ) return FCapstoneBenchmarkResult{ TEXT( "WeaponOnRep" ) };
+
+	// Replays what a client does when CurrentWeapon replicates and the Tick after it, without touching push-model dirty state
+	FCapstoneBenchmarkResult Result = Measure( TEXT( "WeaponOnRep" ), Iterations, [Character, &Spawned]( const int32 Index )
+	{
+		const AWeapon* OldWeapon = Character->CurrentWeapon;
+		Character->CurrentWeapon = Spawned[Index % Spawned.Num()];
+		Character->OnRep_CurrentWeapon( OldWeapon );
+		Character->ApplyWeaponVisibility();
+	} );
+
+	const AWeapon* OldWeapon = Character->CurrentWeapon;
+	Character->CurrentWeapon = StartWeapon;
+	Character->OnRep_CurrentWeapon( OldWeapon );
+	return Result;
+}
+
+void FCapstoneBenchmarks::ProjectileSpawnDestroy( UWorld* World, const TSubclassOf<ANetworkProjectile>& ProjectileClass, const int32 Iterations, TArray<FCapstoneBenchmarkResult>& OutResults )
+{
+	// Far below the level so nothing is hit while the projectiles exist
+	const FTransform SpawnTransform( FVector( 0.0f, 0.0f, -100000.0f ) );
+
+	FActorSpawnParameters Params;
+	Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<ANetworkProjectile*> Projectiles;
+	Projectiles.Reserve( Iterations + 10 );
+
+	OutResults.Add( Measure( TEXT( "ProjectileSpawn" ), Iterations, [&]( const int32 Index )
+	{
+		Projectiles.Add( World->SpawnActor<ANetworkProjectile>( ProjectileClass, SpawnTransform, Params ) );
+	} ) );
+
+	int32 NextToDestroy = 0;
+	OutResults.Add( Measure( TEXT( "ProjectileDestroy" ), Iterations, [&]( const int32 Index )
+	{
+		if ( ANetworkProjectile* Projectile = Projectiles.IsValidIndex( NextToDestroy ) ? Projectiles[NextToDestroy++] : nullptr ) Projectile->Destroy();
+	} ) );
+
+	for ( ; NextToDestroy < Projectiles.Num(); ++NextToDestroy )
+	{
+		if ( Projectiles[NextToDestroy] ) Projectiles[NextToDestroy]->Destroy();
+	}
+}
+
+FCapstoneBenchmarkResult FCapstoneBenchmarks::ProjectilePool( UWorld* World, const TSubclassOf<ANetworkProjectile>& ProjectileClass, const int32 Iterations )
+{
+	UProjectilePoolSubsystem* ProjectilePool = World->GetSubsystem<UProjectilePoolSubsystem>();
+	if ( !ProjectilePool ) return FCapstoneBenchmarkResult{ TEXT( "ProjectilePoolAcquireRelease" ) };
+
+	const FTransform SpawnTransform( FVector( 0.0f, 0.0f, -100000.0f ) );
+	ProjectilePool->Prewarm( ProjectileClass, 1 );
+
+	return Measure( TEXT( "ProjectilePoolAcquireRelease" ), Iterations, [&]( const int32 Index )
+	{
+		if ( ANetworkProjectile* Projectile = ProjectilePool->AcquireProjectile( ProjectileClass, SpawnTransform, nullptr, nullptr ) )
+		{
+			ProjectilePool->ReleaseProjectile( Projectile );
+		}
+	} );
+}
+
+FCapstoneBenchmarkResult FCapstoneBenchmarks::AnimSetVariables( const int32 Iterations )
+{
+	// A standalone proxy fed a plausible snapshot, so the math runs without racing the animation worker threads
+	FFluidAnimInstanceProxy Proxy;
+	Proxy.CameraLocation = FVector( 10.0f, 20.0f, 160.0f );
+	Proxy.RootBoneComponentTransform = FTransform( FRotator( 0.0f, -90.0f, 0.0f ) );
+	Proxy.HandRootWorldTransform = FTransform( FRotator( 0.0f, 30.0f, 0.0f ), FVector( 100.0f, 50.0f, 90.0f ) );
+
+	const float DeltaTime = 1.0f / 60.0f;
+	return Measure( TEXT( "AnimSetVariables" ), Iterations, [&Proxy, DeltaTime]( const int32 Index )
+	{
+		Proxy.AimRotation = FRotator( FMath::Sin( Index * 0.1f ) * 30.0f, Index * 0.5f, 0.0f );
+		Proxy.SetVariables( DeltaTime );
+	} );
+}
+
+// Bits the generic property replication of an FTransform and a float costs
+static int64 GetFullPrecisionBits( FTransform Transform )
+{
+	FBitWriter Writer( 0, true );
+	Writer << Transform;
+	return Writer.GetNumBits();
+}
+
+void FCapstoneBenchmarks::NetSizeReport( const TArray<FString>& Args )
+{
+	const FString Path = Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / TEXT( "Benchmarks" ) / FString::Printf( TEXT( "NetSize-%s.csv" ), *FDateTime::Now().ToString() );
+	FString Csv = TEXT( "Class,Field,FullBits,QuantizedBits" LINE_TERMINATOR );
+
+	// A typical player adjustment: the weapon pulled in a little and tilted, the sights raised
+	FWeaponCustomization Sample;
+	Sample.PlacementOffset = FTransform( FRotator( 2.0f, -1.5f, 0.0f ), FVector( -1.5f, 0.5f, 0.25f ) );
+	Sample.SightsOffset = FTransform( FVector( 0.0f, 0.0f, 0.4f ) );
+	Sample.AimOffsetDelta = -2.0f;
+
+	for ( TObjectIterator<UClass> It; It; ++It )
+	{
+		if ( !It->IsChildOf( AWeapon::StaticClass() ) || It->HasAnyClassFlags( CLASS_Abstract | CLASS_NewerVersionExists ) ) continue;
+
+		const AWeapon* Defaults = It->GetDefaultObject<AWeapon>();
+		FWeaponCustomization Untouched;
+		bool bSuccess = false;
+
+		FBitWriter UntouchedWriter( 0, true );
+		Untouched.NetSerialize( UntouchedWriter, nullptr, bSuccess );
+
+		FBitWriter SampleWriter( 0, true );
+		Sample.NetSerialize( SampleWriter, nullptr, bSuccess );
+
+		// Before, a customized weapon had to send its whole placement and IK transforms
+		const int64 FullCustomizationBits = GetFullPrecisionBits( Defaults->PlacementTransform ) + GetFullPrecisionBits( Defaults->IKProperties.CustomOffsetTransform ) + 32;
+
+		Csv += FString::Printf( TEXT( "%s,CustomizationUntouched,%lld,%lld" LINE_TERMINATOR ), *It->GetName(), FullCustomizationBits, UntouchedWriter.GetNumBits() );
+		Csv += FString::Printf( TEXT( "%s,CustomizationSample,%lld,%lld" LINE_TERMINATOR ), *It->GetName(), FullCustomizationBits, SampleWriter.GetNumBits() );
+	}
+
+	UE_LOG( LogCapstoneBenchmark, Display, TEXT( "%s" ), *Csv );
+
+	TUniquePtr<FArchive> Writer( IFileManager::Get().CreateFileWriter( *Path ) );
+	if ( !Writer )
+	{
+		UE_LOG( LogCapstoneBenchmark, Error, TEXT( "Could not open %s for writing" ), *Path );
+		return;
+	}
+
+	const FTCHARToUTF8 Utf8( *Csv );
+	Writer->Serialize( const_cast<ANSICHAR*>( Utf8.Get() ), Utf8.Length() );
+	if ( Writer->Close() ) UE_LOG( LogCapstoneBenchmark, Display, TEXT( "Wrote net size report to %s" ), *Path );
+}
+
+bool FCapstoneBenchmarks::WriteResults( const TArray<FCapstoneBenchmarkResult>& Results, const FString& Path )
+{
+	TUniquePtr<FArchive> Writer( IFileManager::Get().CreateFileWriter( *Path ) );
+	if ( !Writer )
+	{
+		UE_LOG( LogCapstoneBenchmark, Error, TEXT( "Could not open %s for writing" ), *Path );
+		return false;
+	}
+
+	FString Csv = TEXT( "Benchmark,Iterations,TotalMs,MicrosecondsPerIteration,Allocations,AllocationsPerIteration" LINE_TERMINATOR );
+	for ( const FCapstoneBenchmarkResult& Result : Results )
+	{
+		const int32 Iterations = FMath::Max( Result.Iterations, 1 );
+		Csv += FString::Printf( TEXT( "%s,%d,%.4f,%.4f,%llu,%.4f" LINE_TERMINATOR ),
+			*Result.Name, Result.Iterations, Result.TotalMs, Result.TotalMs * 1000.0 / Iterations, Result.Allocations, static_cast<double>( Result.Allocations ) / Iterations );
+	}
+
+	const FTCHARToUTF8 Utf8( *Csv );
+	Writer->Serialize( const_cast<ANSICHAR*>( Utf8.Get() ), Utf8.Length() );
+	return Writer->Close();
+}
@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class ACapstoneCharacter;
+class ANetworkProjectile;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogCapstoneBenchmark, Log, All );
+
+struct FCapstoneBenchmarkResult
+{
+	FString Name;
+	int32 Iterations = 0;
+	double TotalMs = 0.0;
+	uint64 Allocations = 0;
+};
+
+/**
+ * Micro benchmarks for the character, weapon and projectile hot paths. They run as the automation tests under
+ * Capstone.Benchmarks (see Tests/CapstoneBenchmarkTests.cpp), which fail when a hot path goes over its time or
+ * allocation budget. Headless:
+ *   Capstone /Game/Maps/NetworkTesting -game -nullrhi -unattended -ExecCmds="Automation RunTests Capstone.Benchmarks;Quit"
+ * The console command "Capstone.Benchmark [Iterations] [OutputCsv]" runs the same benchmarks in a standalone or listen
+ * server game and writes one CSV row per benchmark, by default under Saved/Profiling/Benchmarks, so two builds can be
+ * compared by diffing their files.
+ */
+struct FCapstoneBenchmarks
+{
+	static void Run( const TArray<FString>& Args, UWorld* World );
+
+	/** Runs every benchmark World supports. Returns false if World cannot run them at all.*/
+	static bool RunAll( UWorld* World, const int32 Iterations, TArray<FCapstoneBenchmarkResult>& OutResults );
+
+	static FCapstoneBenchmarkResult EquipCycling( ACapstoneCharacter* Character, const int32 Iterations );
+	static FCapstoneBenchmarkResult WeaponOnRep( ACapstoneCharacter* Character, const int32 Iterations );
+	static void ProjectileSpawnDestroy( UWorld* World, const TSubclassOf<ANetworkProjectile>& ProjectileClass, const int32 Iterations, TArray<FCapstoneBenchmarkResult>& OutResults );
+	static FCapstoneBenchmarkResult ProjectilePool( UWorld* World, const TSubclassOf<ANetworkProjectile>& ProjectileClass, const int32 Iterations );
+	static FCapstoneBenchmarkResult AnimSetVariables( const int32 Iterations );
+
+	static bool WriteResults( const TArray<FCapstoneBenchmarkResult>& Results, const FString& Path );
+
+	/**
+	 * "Capstone.NetSizeReport [OutputCsv]" compares the bits full precision and quantized serialization need for the
+	 * weapon transforms of every loaded weapon class. Object references cost the same either way and are left out.
+	 */
+	static void NetSizeReport( const TArray<FString>& Args );
+};
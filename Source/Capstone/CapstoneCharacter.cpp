@@ -12,13 +12,62 @@
 #include "InputActionValue.h"
 
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
 #include "Engine/Engine.h"
+#include "Engine/AssetManager.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/GameStateBase.h"
 
 #include "Weapon.h"
 #include "NetworkProjectile.h"
+#include "ProjectilePoolSubsystem.h"
+#include "ProjectileBatchManager.h"
+#include "DamageBatchManager.h"
+#include "HitScanSubsystem.h"
+#include "LagCompensationSubsystem.h"
+#include "CapstoneSignificanceManager.h"
+#include "RagdollSubsystem.h"
+#include "NetSchedulerSubsystem.h"
+#include "LoadTestSubsystem.h"
+#include "InputReplaySubsystem.h"
+#include "CapstonePlayerState.h"
+#include "CapstoneNetStats.h"
+#include "CapstoneStats.h"
+#include "AllocationCounter.h"
 
 DEFINE_LOG_CATEGORY( LogTemplateCharacter );
 
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<bool> CVarVerifyWeaponSwaps(
+	TEXT( "Capstone.VerifyWeaponSwaps" ),
+	false,
+	TEXT( "Counts heap allocations made by every weapon swap and warns about swaps that allocate." ) );
+#endif
+
+void FWeaponLoadout::PostReplicatedReceive( const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters )
+{
+	if ( Owner ) Owner->OnLoadoutReplicated();
+}
+
+bool FWeaponLoadout::NetDeltaSerialize( FNetDeltaSerializeInfo& DeltaParms )
+{
+	SCOPE_CYCLE_COUNTER( STAT_LoadoutDeltaSerialize );
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const int64 BitsBefore = DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0;
+	const bool bResult = FFastArraySerializer::FastArrayDeltaSerialize<FLoadoutEntry, FWeaponLoadout>( Items, DeltaParms, *this );
+	if ( DeltaParms.Writer )
+	{
+		const int32 Bytes = static_cast<int32>( ( DeltaParms.Writer->GetNumBits() - BitsBefore + 7 ) / 8 );
+		INC_DWORD_STAT_BY( STAT_LoadoutBytesSent, Bytes );
+
+		// Compared and written once per connection, the character's share of the replication pass
+		if ( Owner ) Owner->RecordReplicationCost( FPlatformTime::Cycles64() - StartCycles, Bytes );
+	}
+
+	return bResult;
+}
+
 //////////////////////////////////////////////////////////////////////////
 // ACapstoneCharacter
 
@@ -69,8 +118,11 @@ ACapstoneCharacter::ACapstoneCharacter()
 	// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
 
 	//Initialize the player's Health
-	//MaxHealth = 100.0f;
-	//CurrentHealth = MaxHealth;
+	MaxHealth = 100.0f;
+	CurrentHealth = MaxHealth;
+	bIsRagdoll = false;
+
+	Loadout.Owner = this;
 
 	//Initialize projectile class
 	ProjectileClass = ANetworkProjectile::StaticClass();
@@ -86,6 +138,34 @@ void ACapstoneCharacter::BeginPlay()
 
 	bUseControllerRotationYaw = true;
 
+	if ( HasAuthority() )
+	{
+		if ( ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>() )
+		{
+			LagCompensation->RegisterCharacter( this );
+		}
+
+		if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->RegisterCharacter( this );
+
+		// Spawned up front, unreliable events sent before its channel opens would be lost
+		ADamageBatchManager::Get( this );
+		RegisterProjectileClass();
+
+		// Only the weapon in hand is needed right away, the others are spawned the first time they are equipped
+		Weapons.SetNumZeroed( DefaultWeapons.Num() );
+		if ( DefaultWeapons.IsValidIndex( CurrentIndex ) ) StreamWeapon( CurrentIndex );
+	}
+
+	if ( HasAuthority() || IsLocallyControlled() ) PrewarmWeapons();
+
+	// Animation budgeting only matters where characters are rendered
+	if ( GetNetMode() != NM_DedicatedServer ) UCapstoneSignificanceManager::RegisterCharacter( this );
+}
+
+void ACapstoneCharacter::NotifyControllerChanged()
+{
+	Super::NotifyControllerChanged();
+
 	//Add Input Mapping Context
 	if (APlayerController* PlayerController = Cast<APlayerController>(Controller))
 	{
@@ -95,24 +175,209 @@ void ACapstoneCharacter::BeginPlay()
 		}
 	}
 
-	if ( HasAuthority() )
+	// A respawned character may still be in the camera mode its previous player left it in
+	if ( IsLocallyControlled() )
+	{
+		FollowCamera->SetActive( FollowCamera->IsAutoActivate() );
+		FPSCamera->SetActive( FPSCamera->IsAutoActivate() );
+		bIsAiming = false;
+	}
+}
+
+void ACapstoneCharacter::PossessedBy( AController* NewController )
+{
+	Super::PossessedBy( NewController );
+
+	// Only set right after seamless travel, the player picks up with the loadout it left the last map with
+	FSavedLoadout SavedLoadout;
+	ACapstonePlayerState* CapstonePlayerState = GetPlayerState<ACapstonePlayerState>();
+	if ( !CapstonePlayerState || !CapstonePlayerState->ConsumeSavedLoadout( SavedLoadout ) ) return;
+
+	// Nothing another player did to this character's weapons carries over, only the saved slots are customized
+	RestoredCustomizations.Reset();
+	for ( AWeapon* Weapon : Weapons )
+	{
+		if ( Weapon ) Weapon->SetCustomization( FWeaponCustomization() );
+	}
+
+	for ( const FSavedWeapon& Saved : SavedLoadout.Weapons )
+	{
+		// This map's character may come with a different loadout
+		if ( !DefaultWeapons.IsValidIndex( Saved.Slot ) || DefaultWeapons[Saved.Slot] != Saved.WeaponClass ) continue;
+
+		if ( Weapons.IsValidIndex( Saved.Slot ) && Weapons[Saved.Slot] ) Weapons[Saved.Slot]->SetCustomization( Saved.Customization );
+		else RestoredCustomizations.Add( Saved.Slot, Saved.Customization );
+	}
+
+	if ( Weapons.IsValidIndex( SavedLoadout.CurrentIndex ) ) EquipSlot( SavedLoadout.CurrentIndex );
+}
+
+void ACapstoneCharacter::SaveLoadout()
+{
+	ACapstonePlayerState* CapstonePlayerState = GetPlayerState<ACapstonePlayerState>();
+	if ( !HasAuthority() || !CapstonePlayerState ) return;
+
+	FSavedLoadout SavedLoadout;
+	SavedLoadout.CurrentIndex = CurrentIndex;
+	for ( int32 Slot = 0; Slot < Weapons.Num(); ++Slot )
+	{
+		if ( !Weapons[Slot] || !DefaultWeapons.IsValidIndex( Slot ) ) continue;
+
+		FSavedWeapon& Saved = SavedLoadout.Weapons.AddDefaulted_GetRef();
+		Saved.Slot = Slot;
+		Saved.WeaponClass = DefaultWeapons[Slot];
+		Saved.Customization = Weapons[Slot]->GetCustomization();
+	}
+
+	CapstonePlayerState->SaveLoadout( SavedLoadout );
+}
+
+void ACapstoneCharacter::AddSeamlessTravelActors( TArray<AActor*>& ActorList )
+{
+	ActorList.Add( this );
+	for ( AWeapon* Weapon : Weapons )
+	{
+		if ( Weapon ) ActorList.Add( Weapon );
+	}
+}
+
+void ACapstoneCharacter::OnTravelledToWorld()
+{
+	if ( !HasAuthority() ) return;
+
+	// BeginPlay does not run again for actors kept through travel, what it registered with the last map is registered here
+	ADamageBatchManager::Get( this );
+	RegisterProjectileClass();
+
+	if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() )
+	{
+		for ( AWeapon* Weapon : Weapons )
+		{
+			if ( Weapon ) NetScheduler->RegisterWeapon( Weapon );
+		}
+	}
+
+	if ( GetNetMode() != NM_DedicatedServer ) UCapstoneSignificanceManager::RegisterCharacter( this );
+}
+
+void ACapstoneCharacter::RegisterProjectileClass()
+{
+	if ( bUseBatchedProjectiles )
+	{
+		if ( AProjectileBatchManager* ProjectileManager = AProjectileBatchManager::Get( this ) )
+		{
+			ProjectileManager->RegisterProjectileType( ProjectileClass );
+		}
+	}
+	else if ( UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>() )
+	{
+		ProjectilePool->Prewarm( ProjectileClass, 0 );
+	}
+}
+
+void ACapstoneCharacter::DeactivateToPool()
+{
+	if ( !HasAuthority() ) return;
+
+	bPooled = true;
+
+	bIsFiringWeapon = false;
+	GetWorldTimerManager().ClearTimer( FiringTimer );
+	PendingShots.Reset();
+	RestoredCustomizations.Reset();
+
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+	SetActorEnableCollision( false );
+	SetActorHiddenInGame( true );
+	SetActorTickEnabled( false );
+
+	// The weapons stay attached for the next respawn, with nothing in hand they are all hidden and dormant
+	const AWeapon* OldWeapon = CurrentWeapon;
+	SetCurrentWeapon( nullptr );
+	OnRep_CurrentWeapon( OldWeapon );
+	ApplyWeaponVisibility();
+
+	if ( ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>() ) LagCompensation->UnregisterCharacter( this );
+	if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->UnregisterCharacter( this );
+
+	// Send the hidden state once, then stop considering the character for replication until it is respawned
+	ForceNetUpdate();
+	SetNetDormancy( DORM_DormantAll );
+}
+
+void ACapstoneCharacter::ActivateFromPool( const FTransform& SpawnTransform )
+{
+	if ( !HasAuthority() ) return;
+
+	bPooled = false;
+
+	SetNetDormancy( DORM_Awake );
+
+	SetActorTransform( SpawnTransform, false, nullptr, ETeleportType::ResetPhysics );
+	SetActorHiddenInGame( false );
+	SetActorEnableCollision( true );
+	SetActorTickEnabled( true );
+	SetReplicateMovement( true );
+
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->SetDefaultMovementMode();
+	GetCapsuleComponent()->SetCollisionEnabled( GetClass()->GetDefaultObject<ACapstoneCharacter>()->GetCapsuleComponent()->GetCollisionEnabled() );
+
+	SetCurrentHealth( MaxHealth );
+	if ( bIsRagdoll )
 	{
-		for ( const TSubclassOf<AWeapon>& WeaponClass : DefaultWeapons )
+		bIsRagdoll = false;
+		MARK_PROPERTY_DIRTY_FROM_NAME( ACapstoneCharacter, bIsRagdoll, this );
+
+		if ( GetNetMode() != NM_DedicatedServer ) OnRep_Ragdoll();
+	}
+
+	// Nothing of the previous life carries over to shot validation or lag compensation
+	LastCombatTime = -1.0f;
+	LastAcceptedShotTime = -1.0f;
+	LastAcceptedBatchTime = -1.0f;
+	PoseHistory.Reset();
+
+	if ( ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>() ) LagCompensation->RegisterCharacter( this );
+	if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->RegisterCharacter( this );
+
+	// Back to the slot the character spawns with, its weapon is usually still attached from the previous life
+	const int32 DefaultIndex = GetClass()->GetDefaultObject<ACapstoneCharacter>()->CurrentIndex;
+	if ( Weapons.IsValidIndex( DefaultIndex ) ) EquipSlot( DefaultIndex );
+
+	ForceNetUpdate();
+}
+
+void ACapstoneCharacter::EndPlay( const EEndPlayReason::Type EndPlayReason )
+{
+	if ( ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>() )
+	{
+		LagCompensation->UnregisterCharacter( this );
+	}
+
+	if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->UnregisterCharacter( this );
+
+	for ( const TSharedPtr<FStreamableHandle>& Handle : WeaponLoadHandles )
+	{
+		if ( Handle.IsValid() ) Handle->CancelHandle();
+	}
+	WeaponLoadHandles.Reset();
+
+	if ( GetNetMode() != NM_DedicatedServer ) UCapstoneSignificanceManager::UnregisterCharacter( this );
+
+	if ( URagdollSubsystem* Ragdolls = GetWorld()->GetSubsystem<URagdollSubsystem>() ) Ragdolls->RemoveCharacter( this );
+
+	// Weapons only exist for their character, nothing else would ever clean them up
+	if ( HasAuthority() && EndPlayReason == EEndPlayReason::Destroyed )
+	{
+		for ( AWeapon* Weapon : Weapons )
 		{
-			if ( !WeaponClass ) continue;
-
-			FActorSpawnParameters Params;
-			Params.Owner = this;
-
-			AWeapon* SpawnedWeapon = GetWorld()->SpawnActor<AWeapon>( WeaponClass, Params );
-			const int32 index = Weapons.Add( SpawnedWeapon );
-			if ( index == CurrentIndex )
-			{
-				CurrentWeapon = SpawnedWeapon;
-				OnRep_CurrentWeapon( nullptr );
-			}
+			if ( Weapon ) Weapon->Destroy();
 		}
 	}
+
+	Super::EndPlay( EndPlayReason );
 }
 
 // For the character networking
@@ -120,93 +385,327 @@ void ACapstoneCharacter::GetLifetimeReplicatedProps( TArray <FLifetimeProperty>&
 {
 	Super::GetLifetimeReplicatedProps( OutLifetimeProps );
 
+	// Push-model properties are only compared after they are marked dirty, not every tick for every connection
+	FDoRepLifetimeParams PushParams;
+	PushParams.bIsPushBased = true;
+
 	//Replicate current health.
-	//DOREPLIFETIME( ACapstoneCharacter, CurrentHealth);
-	DOREPLIFETIME_CONDITION( ACapstoneCharacter, Weapons, COND_None );
-	DOREPLIFETIME_CONDITION( ACapstoneCharacter, CurrentWeapon, COND_None );
-	//DOREPLIFETIME( ACapstoneCharacter, bIsRagdoll );
+	DOREPLIFETIME_WITH_PARAMS_FAST( ACapstoneCharacter, CurrentHealth, PushParams );
+	DOREPLIFETIME_WITH_PARAMS_FAST( ACapstoneCharacter, Loadout, PushParams );
+	DOREPLIFETIME_WITH_PARAMS_FAST( ACapstoneCharacter, CurrentWeapon, PushParams );
+	DOREPLIFETIME_WITH_PARAMS_FAST( ACapstoneCharacter, bIsRagdoll, PushParams );
 }
 
-void ACapstoneCharacter::OnRep_CurrentWeapon( const AWeapon* OldWeapon )
+void ACapstoneCharacter::PreReplication( IRepChangedPropertyTracker& ChangedPropertyTracker )
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	Super::PreReplication( ChangedPropertyTracker );
+	RecordReplicationCost( FPlatformTime::Cycles64() - StartCycles, 0 );
+}
+
+void ACapstoneCharacter::RecordReplicationCost( const uint64 Cycles, const int32 Bytes )
+{
+#if CSV_PROFILER
+	if ( !FCsvProfiler::Get()->IsCapturing() ) return;
+
+	// Pooled characters keep their name, a respawned player continues the same columns
+	if ( CsvReplicationTimeStat.IsNone() )
+	{
+		CsvReplicationTimeStat = FName( GetName() + TEXT( "/ReplicationMs" ) );
+		CsvBytesSentStat = FName( GetName() + TEXT( "/BytesSent" ) );
+	}
+
+	FCsvProfiler::RecordCustomStat( CsvReplicationTimeStat, CSV_CATEGORY_INDEX( CapstoneNet ), static_cast<float>( FPlatformTime::ToMilliseconds64( Cycles ) ), ECsvCustomStatOp::Accumulate );
+	if ( Bytes > 0 ) FCsvProfiler::RecordCustomStat( CsvBytesSentStat, CSV_CATEGORY_INDEX( CapstoneNet ), Bytes, ECsvCustomStatOp::Accumulate );
+#endif
+}
+
+bool ACapstoneCharacter::CallRemoteFunction( UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack )
+{
+	// The bits an RPC appends to the send buffer are its size on the wire, headers included
+	UNetConnection* Connection = Function->HasAnyFunctionFlags( FUNC_NetServer ) && !HasAuthority() ? GetNetConnection() : nullptr;
+	const int64 BitsBefore = Connection ? Connection->SendBuffer.GetNumBits() : 0;
+
+	const bool bProcessed = Super::CallRemoteFunction( Function, Parameters, OutParms, Stack );
+
+	// A flush in between empties the buffer, such a call cannot be measured
+	const int64 Bits = Connection ? Connection->SendBuffer.GetNumBits() - BitsBefore : 0;
+	if ( Bits > 0 ) CapstoneStats::RecordSentRPC( Bits );
+
+	return bProcessed;
+}
+
+void ACapstoneCharacter::SetCurrentWeapon( AWeapon* NewWeapon )
+{
+	AWeapon* OldWeapon = CurrentWeapon;
+	CurrentWeapon = NewWeapon;
+
+	MARK_PROPERTY_DIRTY_FROM_NAME( ACapstoneCharacter, CurrentWeapon, this );
+	INC_DWORD_STAT( STAT_CharacterDirtyMarks );
+
+	// Only the weapon in hand stays awake, clients show or hide the others from CurrentWeapon alone
+	if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() )
+	{
+		if ( OldWeapon != NewWeapon ) NetScheduler->HolsterWeapon( OldWeapon );
+		NetScheduler->EquipWeapon( NewWeapon );
+	}
+}
+
+void ACapstoneCharacter::AddToLoadout( AWeapon* NewWeapon, const int32 Slot )
+{
+	if ( Weapons.Num() <= Slot ) Weapons.SetNumZeroed( Slot + 1 );
+	Weapons[Slot] = NewWeapon;
+
+	FLoadoutEntry& Entry = Loadout.Items.AddDefaulted_GetRef();
+	Entry.Weapon = NewWeapon;
+	Entry.Slot = Slot;
+	Loadout.MarkItemDirty( Entry );
+
+	MARK_PROPERTY_DIRTY_FROM_NAME( ACapstoneCharacter, Loadout, this );
+	INC_DWORD_STAT( STAT_CharacterDirtyMarks );
+}
+
+void ACapstoneCharacter::LoadWeaponClass( const int32 Slot, FStreamableDelegate Delegate )
 {
-	if ( CurrentWeapon )
+	if ( WeaponLoadHandles.Num() <= Slot ) WeaponLoadHandles.SetNum( Slot + 1 );
+
+	// A handle that is still loading only needs the delegate added, a finished one keeps the class resident
+	TSharedPtr<FStreamableHandle>& Handle = WeaponLoadHandles[Slot];
+	if ( Handle.IsValid() && Handle->IsActive() )
 	{
-		if ( !CurrentWeapon->CurrentOwner )
+		if ( Delegate.IsBound() )
 		{
-			const FTransform& PlacementTransform = CurrentWeapon->PlacementTransform * GetMesh()->GetSocketTransform( FName( "weapon_r" ) );
-			CurrentWeapon->SetActorTransform( PlacementTransform, false, nullptr, ETeleportType::TeleportPhysics);
-			CurrentWeapon->AttachToComponent( GetMesh(), FAttachmentTransformRules::KeepWorldTransform, FName( "weapon_r" ) );
-			CurrentWeapon->CurrentOwner = this;
+			if ( Handle->HasLoadCompleted() ) Delegate.Execute();
+			else Handle->BindCompleteDelegate( Delegate );
 		}
+		return;
+	}
+
+	Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad( DefaultWeapons[Slot].ToSoftObjectPath(), Delegate );
+}
+
+void ACapstoneCharacter::StreamWeapon( const int32 Slot )
+{
+	if ( DefaultWeapons[Slot].IsNull() || Weapons[Slot] ) return;
+
+	if ( DefaultWeapons[Slot].Get() )
+	{
+		OnWeaponClassLoaded( Slot );
+		return;
+	}
+
+	LoadWeaponClass( Slot, FStreamableDelegate::CreateUObject( this, &ACapstoneCharacter::OnWeaponClassLoaded, Slot ) );
+}
+
+void ACapstoneCharacter::OnWeaponClassLoaded( const int32 Slot )
+{
+	if ( IsActorBeingDestroyed() || Weapons[Slot] ) return;
+
+	UClass* WeaponClass = DefaultWeapons[Slot].Get();
+	if ( !WeaponClass ) return;
+
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_WeaponSpawn );
+
+	FActorSpawnParameters Params;
+	Params.Owner = this;
 
-		CurrentWeapon->Mesh->SetVisibility( true );
+	AWeapon* SpawnedWeapon = GetWorld()->SpawnActor<AWeapon>( WeaponClass, Params );
+	AddToLoadout( SpawnedWeapon, Slot );
+	AttachWeapon( SpawnedWeapon );
+
+	FWeaponCustomization Restored;
+	if ( SpawnedWeapon && RestoredCustomizations.RemoveAndCopyValue( Slot, Restored ) ) SpawnedWeapon->SetCustomization( Restored );
+
+	// The player may have moved on to another slot while this one was loading. A pooled character only keeps the
+	// weapon holstered and dormant, ActivateFromPool equips it when the character comes back into play
+	if ( Slot == CurrentIndex && !bPooled )
+	{
+		const AWeapon* OldWeapon = CurrentWeapon;
+		SetCurrentWeapon( SpawnedWeapon );
+		OnRep_CurrentWeapon( OldWeapon );
 	}
+}
 
-	if ( OldWeapon )
+void ACapstoneCharacter::PrewarmWeapons()
+{
+	const int32 NumSlots = DefaultWeapons.Num();
+	if ( NumSlots == 0 ) return;
+
+	for ( int32 Offset = 1; Offset <= FMath::Min( PrewarmWeaponCount, NumSlots / 2 ); ++Offset )
 	{
-		OldWeapon->Mesh->SetVisibility( false );
+		for ( const int32 Slot : { ( CurrentIndex + Offset ) % NumSlots, ( CurrentIndex - Offset + NumSlots ) % NumSlots } )
+		{
+			if ( !DefaultWeapons[Slot].IsNull() && !DefaultWeapons[Slot].Get() ) LoadWeaponClass( Slot );
+		}
 	}
+}
 
-	CurrentWeaponChangeDelegate.Broadcast( CurrentWeapon, OldWeapon );
+void ACapstoneCharacter::OnLoadoutReplicated()
+{
+	// Slots that were never equipped stay empty until the server spawns their weapon
+	Weapons.Reset();
+	Weapons.SetNumZeroed( DefaultWeapons.Num() );
+	for ( const FLoadoutEntry& Entry : Loadout.Items )
+	{
+		if ( Weapons.Num() <= Entry.Slot ) Weapons.SetNumZeroed( Entry.Slot + 1 );
+		Weapons[Entry.Slot] = Entry.Weapon;
+
+		if ( Entry.Weapon && Entry.Weapon->CurrentOwner != this ) AttachWeapon( Entry.Weapon );
+	}
+}
+
+void ACapstoneCharacter::OnRep_CurrentWeapon( const AWeapon* OldWeapon )
+{
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_OnRepCurrentWeapon );
+
+	// Normally done when the weapon joined the loadout, CurrentWeapon can replicate before the loadout does
+	if ( CurrentWeapon && CurrentWeapon->CurrentOwner != this ) AttachWeapon( CurrentWeapon );
+
+#if !UE_BUILD_SHIPPING
+	TOptional<FScopedAllocationCounter> SwapAllocations;
+	if ( CVarVerifyWeaponSwaps.GetValueOnGameThread() ) SwapAllocations.Emplace();
+#endif
+
+	// Scrolling through several weapons in one frame only shows the last one, see ApplyWeaponVisibility
+	bWeaponVisibilityDirty = true;
+	INC_DWORD_STAT( STAT_WeaponSwaps );
+
+	// Broadcasting a dynamic delegate builds its parameters through reflection, skip it when nothing listens
+	if ( CurrentWeaponChangeDelegate.IsBound() ) CurrentWeaponChangeDelegate.Broadcast( CurrentWeapon, OldWeapon );
+
+#if !UE_BUILD_SHIPPING
+	// The visibility change is part of the swap, verified swaps apply it now instead of in the next Tick
+	if ( SwapAllocations ) ApplyWeaponVisibility();
+
+	if ( SwapAllocations && SwapAllocations->GetCount() > 0 )
+	{
+		INC_DWORD_STAT_BY( STAT_WeaponSwapAllocations, SwapAllocations->GetCount() );
+		UE_LOG( LogTemplateCharacter, Warning, TEXT( "Weapon swap on %s made %llu allocations" ), *GetName(), SwapAllocations->GetCount() );
+	}
+#endif
+}
+
+void ACapstoneCharacter::AttachWeapon( AWeapon* Weapon )
+{
+	static const FName WeaponSocketName( "weapon_r" );
+
+	Weapon->SetActorRelativeTransform( Weapon->PlacementTransform );
+	Weapon->AttachToComponent( GetMesh(), FAttachmentTransformRules::KeepRelativeTransform, WeaponSocketName );
+	Weapon->CurrentOwner = this;
+
+	// Attachment replicates with the weapon
+	if ( HasAuthority() )
+	{
+		if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->WakeWeapon( Weapon );
+	}
+
+	// The weapon is rigidly attached to the socket, so its sights never move relative to it
+	Weapon->HandToSightsTransform = Weapon->GetSightsWorldTransform().GetRelativeTransform( GetMesh()->GetSocketTransform( WeaponSocketName ) );
+
+	if ( Weapon != CurrentWeapon ) Weapon->Mesh->SetVisibility( false );
+}
+
+void ACapstoneCharacter::ApplyWeaponVisibility()
+{
+	bWeaponVisibilityDirty = false;
+
+	for ( AWeapon* Weapon : Weapons )
+	{
+		if ( !Weapon || Weapon->CurrentOwner != this ) continue;
+
+		const bool bVisible = Weapon == CurrentWeapon;
+		if ( Weapon->Mesh->GetVisibleFlag() == bVisible ) continue;
+
+		Weapon->Mesh->SetVisibility( bVisible );
+		INC_DWORD_STAT( STAT_WeaponVisibilityChanges );
+	}
 }
 
 ///// Character health and network interactions
-//void ACapstoneCharacter::OnRep_CurrentHealth()
-//{
-//	OnHealthUpdate();
-//}
-//
-//void ACapstoneCharacter::SetCurrentHealth( float healthValue )
-//{
-//	if ( GetLocalRole() == ROLE_Authority )
-//	{
-//		CurrentHealth = FMath::Clamp( healthValue, 0.f, MaxHealth );
-//		OnHealthUpdate();
-//	}
-//}
-//
-//float ACapstoneCharacter::TakeDamage( float DamageTaken, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser )
-//{
-//	float damageApplied = CurrentHealth - DamageTaken;
-//	SetCurrentHealth( damageApplied );
-//	return damageApplied;
-//}
-//
-//void ACapstoneCharacter::OnHealthUpdate()
-//{
-//	//Client-specific functionality
-//	if ( IsLocallyControlled() )
-//	{
-//		/*FString healthMessage = FString::Printf( TEXT( "You now have %f health remaining." ), CurrentHealth );
-//		GEngine->AddOnScreenDebugMessage( -1, 5.f, FColor::Blue, healthMessage );*/
-//
-//		if ( CurrentHealth <= 0 )
-//		{
-//			FString deathMessage = FString::Printf( TEXT( "%s has been killed." ), *GetFName().ToString() );
-//			GEngine->AddOnScreenDebugMessage( -1, 5.f, FColor::Red, deathMessage );
-//			OnRep_Ragdoll();
-//			GetMesh()->SetSimulatePhysics( bIsRagdoll );
-//		}
-//	}
-//
-//	//Server-specific functionality
-//	if ( GetLocalRole() == ROLE_Authority )
-//	{
-//		/*FString healthMessage = FString::Printf( TEXT( "%s now has %f health remaining." ), *GetFName().ToString(), CurrentHealth );
-//		GEngine->AddOnScreenDebugMessage( -1, 5.f, FColor::Blue, healthMessage );*/
-//	}
-//
-//	//Functions that occur on all machines.
-//	/*
-//		Any special functionality that should occur as a result of damage or death should be placed here.
-//	*/
-//}
-//
-//void ACapstoneCharacter::OnRep_Ragdoll()
-//{
-//	bIsRagdoll = true;
-//	GetMesh()->SetSimulatePhysics( true );
-//}
+void ACapstoneCharacter::OnRep_CurrentHealth()
+{
+	OnHealthUpdate();
+}
+
+void ACapstoneCharacter::SetCurrentHealth( float healthValue )
+{
+	if ( GetLocalRole() == ROLE_Authority )
+	{
+		const float NewHealth = FMath::Clamp( healthValue, 0.f, MaxHealth );
+		if ( NewHealth == CurrentHealth ) return;
+
+		CurrentHealth = NewHealth;
+		MARK_PROPERTY_DIRTY_FROM_NAME( ACapstoneCharacter, CurrentHealth, this );
+		INC_DWORD_STAT( STAT_CharacterDirtyMarks );
+
+		OnHealthUpdate();
+	}
+}
+
+float ACapstoneCharacter::TakeDamage( float DamageTaken, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser )
+{
+	const float DamageApplied = Super::TakeDamage( DamageTaken, DamageEvent, EventInstigator, DamageCauser );
+	if ( !HasAuthority() || IsDead() || DamageApplied <= 0.0f ) return 0.0f;
+
+	// Every hit of the frame is summed and applied once, so a shotgun blast is one health change instead of dozens
+	AActor* DamageInstigator = EventInstigator ? EventInstigator->GetPawn() : DamageCauser;
+	if ( ADamageBatchManager* DamageManager = ADamageBatchManager::Get( this ) ) DamageManager->QueueDamage( this, DamageApplied, DamageInstigator );
+	else SetCurrentHealth( CurrentHealth - DamageApplied );
+
+	return DamageApplied;
+}
+
+void ACapstoneCharacter::OnHealthUpdate()
+{
+	//Client-specific functionality
+	if ( IsLocallyControlled() )
+	{
+		if ( CurrentHealth <= 0 ) StopFire();
+	}
+
+	//Server-specific functionality
+	if ( GetLocalRole() == ROLE_Authority )
+	{
+		if ( CurrentHealth <= 0 && !bIsRagdoll )
+		{
+			bIsRagdoll = true;
+			MARK_PROPERTY_DIRTY_FROM_NAME( ACapstoneCharacter, bIsRagdoll, this );
+
+			// Bodies are simulated by each client on its own, only the death itself goes over the wire
+			SetReplicateMovement( false );
+
+			// Corpses stop shots and bodies on no machine, clients turn off the same capsule when they ragdoll
+			GetCapsuleComponent()->SetCollisionEnabled( ECollisionEnabled::NoCollision );
+			GetCharacterMovement()->DisableMovement();
+			if ( ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>() ) LagCompensation->UnregisterCharacter( this );
+
+			// A listen server draws the ragdoll too, a dedicated one has nobody to show it to
+			if ( GetNetMode() != NM_DedicatedServer ) OnRep_Ragdoll();
+		}
+	}
+
+	//Functions that occur on all machines.
+	/*
+		Any special functionality that should occur as a result of damage or death should be placed here.
+	*/
+}
+
+void ACapstoneCharacter::OnRep_Ragdoll()
+{
+	URagdollSubsystem* Ragdolls = GetWorld()->GetSubsystem<URagdollSubsystem>();
+	if ( !Ragdolls ) return;
+
+	// A pooled character coming back to life has to undo its death
+	if ( !bIsRagdoll )
+	{
+		if ( bDeathStarted ) Ragdolls->Revive( this );
+		bDeathStarted = false;
+		return;
+	}
+
+	bDeathStarted = true;
+	Ragdolls->StartDeath( this, DeathAnimation, RagdollPhysicsAsset );
+}
 
 //////////////////////////////////////////////////////////////////////////
 // Input
@@ -220,8 +719,8 @@ void ACapstoneCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputC
 		EnhancedInputComponent->BindAction( SelectAction, ETriggerEvent::Triggered, this, &ACapstoneCharacter::SwitchCameras );
 		
 		// Jumping
-		EnhancedInputComponent->BindAction(JumpAction, ETriggerEvent::Started, this, &ACharacter::Jump);
-		EnhancedInputComponent->BindAction(JumpAction, ETriggerEvent::Completed, this, &ACharacter::StopJumping);
+		EnhancedInputComponent->BindAction(JumpAction, ETriggerEvent::Started, this, &ACapstoneCharacter::Jump);
+		EnhancedInputComponent->BindAction(JumpAction, ETriggerEvent::Completed, this, &ACapstoneCharacter::StopJumping);
 
 		// Moving
 		EnhancedInputComponent->BindAction(MoveAction, ETriggerEvent::Triggered, this, &ACapstoneCharacter::Move);
@@ -252,6 +751,7 @@ void ACapstoneCharacter::Move(const FInputActionValue& Value)
 {
 	// input is a Vector2D
 	FVector2D MovementVector = Value.Get<FVector2D>();
+	UInputReplaySubsystem::Record( this, EReplayInput::Move, MovementVector );
 
 	if (Controller != nullptr )
 	{
@@ -286,6 +786,7 @@ void ACapstoneCharacter::Look(const FInputActionValue& Value)
 {
 	// input is a Vector2D
 	FVector2D LookAxisVector = Value.Get<FVector2D>();
+	UInputReplaySubsystem::Record( this, EReplayInput::Look, LookAxisVector );
 
 	// enables head rotation animation
 	yaw += LookAxisVector.X;
@@ -316,62 +817,300 @@ void ACapstoneCharacter::PrevTool()
 
 void ACapstoneCharacter::Equip( const int32 index )
 {
-	if(EquippingAnimations[index]) PlayAnimMontage( EquippingAnimations[index] );
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_Equip );
+
+	UInputReplaySubsystem::Record( this, EReplayInput::Equip, FVector2D( index, 0.0f ) );
+
+	if ( EquippingAnimations.IsValidIndex( index ) && EquippingAnimations[index] ) PlayAnimMontage( EquippingAnimations[index] );
 
 	//GetMesh()->PlayAnimation()
 
-	if ( !Weapons.IsValidIndex( index ) || CurrentWeapon == Weapons[index] ) return;
+	if ( !Weapons.IsValidIndex( index ) || ( index == CurrentIndex && CurrentWeapon == Weapons[index] ) ) return;
 
-	if ( IsLocallyControlled() )
+	if ( HasAuthority() )
+	{
+		EquipSlot( index );
+	}
+	else if ( IsLocallyControlled() )
 	{
+		// Swap right away if the weapon already exists, otherwise it shows up once the server has spawned it
 		CurrentIndex = index;
-		const AWeapon* OldWeapon = CurrentWeapon;
-		CurrentWeapon = Weapons[index];
-		OnRep_CurrentWeapon( OldWeapon );
+		if ( Weapons[index] )
+		{
+			const AWeapon* OldWeapon = CurrentWeapon;
+			SetCurrentWeapon( Weapons[index] );
+			OnRep_CurrentWeapon( OldWeapon );
+		}
+
+		Server_Equip( index );
+		PrewarmWeapons();
 	}
-	else if ( !HasAuthority() )
+}
+
+void ACapstoneCharacter::Server_Equip_Implementation( const int32 index )
+{
+	CAPSTONE_SERVER_RPC( STAT_ServerRPC_Equip );
+	ULoadTestSubsystem::RecordRPC( this );
+
+	EquipSlot( index );
+}
+
+void ACapstoneCharacter::EquipSlot( const int32 index )
+{
+	if ( !Weapons.IsValidIndex( index ) ) return;
+
+	CurrentIndex = index;
+	if ( !Weapons[index] )
+	{
+		StreamWeapon( index );
+	}
+	else if ( Weapons[index] != CurrentWeapon )
 	{
-		Server_SetWeapon( Weapons[index] );
+		const AWeapon* OldWeapon = CurrentWeapon;
+		SetCurrentWeapon( Weapons[index] );
+		OnRep_CurrentWeapon( OldWeapon );
 	}
+
+	PrewarmWeapons();
 }
 
-void ACapstoneCharacter::Server_SetWeapon_Implementation( AWeapon* newWeapon )
+void ACapstoneCharacter::Server_CustomizeWeapon_Implementation( const int32 Slot, const FWeaponCustomization& Customization )
 {
-	const AWeapon* OldWeapon = CurrentWeapon;
-	CurrentWeapon = newWeapon;
-	OnRep_CurrentWeapon( OldWeapon );
+	CAPSTONE_SERVER_RPC( STAT_ServerRPC_CustomizeWeapon );
+	ULoadTestSubsystem::RecordRPC( this );
+
+	if ( !Weapons.IsValidIndex( Slot ) || !Weapons[Slot] ) return;
+
+	// Players may nudge a weapon around, not move it out of their hands
+	FWeaponCustomization Clamped = Customization;
+	for ( FTransform* Offset : { &Clamped.PlacementOffset, &Clamped.SightsOffset } )
+	{
+		Offset->SetTranslation( Offset->GetTranslation().GetClampedToMaxSize( MaxCustomizationOffset ) );
+		Offset->SetScale3D( Offset->GetScale3D().BoundToBox( FVector( 0.5f ), FVector( 1.5f ) ) );
+	}
+	Clamped.AimOffsetDelta = FMath::Clamp( Clamped.AimOffsetDelta, -MaxCustomizationOffset, MaxCustomizationOffset );
+
+	Weapons[Slot]->SetCustomization( Clamped );
 }
 
 void ACapstoneCharacter::StartFire( const FInputActionValue& Value )
 {
-	/*const bool CurrentValue = Value.Get<bool>();
+	UInputReplaySubsystem::Record( this, EReplayInput::FireStart );
 
-	if ( CurrentValue ) { UE_LOG( LogTemp, Warning, TEXT( "Left Mouse Clicked" ) ); }
+	if ( bIsFiringWeapon || IsDead() ) return;
 
-	if ( !bIsFiringWeapon )
-	{
-		bIsFiringWeapon = true;
-		UWorld* World = GetWorld();
-		World->GetTimerManager().SetTimer( FiringTimer, this, &ACapstoneCharacter::StopFire, FireRate, false );
-		HandleFire();
-	}*/
+	bIsFiringWeapon = true;
+	FireShot();
+
+	// Keep firing at FireRate for as long as the button is held
+	GetWorldTimerManager().SetTimer( FiringTimer, this, &ACapstoneCharacter::FireShot, FireRate, true );
 }
 
 void ACapstoneCharacter::StopFire()
 {
+	UInputReplaySubsystem::Record( this, EReplayInput::FireStop );
+
 	bIsFiringWeapon = false;
+	GetWorldTimerManager().ClearTimer( FiringTimer );
 }
 
-void ACapstoneCharacter::HandleFire_Implementation()
+void ACapstoneCharacter::FireShot()
 {
-	/*FVector spawnLocation = GetActorLocation() + ( GetActorRotation().Vector() * 100.0f ) + ( GetActorUpVector() * 50.0f );
-	FRotator spawnRotation = GetActorRotation();
+	const FVector spawnLocation = GetActorLocation() + ( GetActorRotation().Vector() * 100.0f ) + ( GetActorUpVector() * 50.0f );
+	const FVector spawnDirection = GetBaseAimRotation().Vector();
 
-	FActorSpawnParameters spawnParameters;
-	spawnParameters.Instigator = GetInstigator();
-	spawnParameters.Owner = this;
+	NotifyCombat();
+	if ( CurrentWeapon ) CurrentWeapon->AddRecoil();
 
-	ANetworkProjectile* spawnedProjectile = GetWorld()->SpawnActor<ANetworkProjectile>( spawnLocation, spawnRotation, spawnParameters );*/
+	// Hit-scan spread is seeded from the key, so the host numbers its shots as well
+	LastPredictionKey = LastPredictionKey == MAX_uint16 ? 1 : LastPredictionKey + 1;
+
+	// Hit-scan shots are drawn right away, the server resolves them within a frame and sends the impacts to everyone else
+	const bool bHitScan = CurrentWeapon && CurrentWeapon->FireMode == EWeaponFireMode::HitScan;
+	if ( bHitScan )
+	{
+		if ( UHitScanSubsystem* HitScan = GetWorld()->GetSubsystem<UHitScanSubsystem>() )
+		{
+			HitScan->FireCosmetic( CurrentWeapon, this, spawnLocation, spawnDirection, LastPredictionKey );
+		}
+	}
+
+	// The listen server host has nothing to predict
+	if ( HasAuthority() )
+	{
+		SpawnProjectile( spawnLocation, spawnDirection, LastPredictionKey, 0.0f );
+		return;
+	}
+
+	AProjectileBatchManager* ProjectileManager = bUseBatchedProjectiles && !bHitScan ? AProjectileBatchManager::Get( this ) : nullptr;
+	if ( ProjectileManager )
+	{
+		ProjectileManager->FirePredictedProjectile( ProjectileClass, spawnLocation, spawnDirection, this, LastPredictionKey );
+	}
+
+	FPredictedShot& Shot = PendingShots.AddDefaulted_GetRef();
+	Shot.PredictionKey = LastPredictionKey;
+	Shot.Origin = spawnLocation;
+	Shot.Direction = spawnDirection;
+	Shot.ClientTime = GetEstimatedServerTime();
+	Shot.ViewTime = Shot.ClientTime - GetRemoteViewDelay();
+}
+
+void ACapstoneCharacter::UpdateServerClock( const float DeltaSeconds )
+{
+	const AGameStateBase* GameState = GetWorld()->GetGameState();
+	if ( !GameState ) return;
+
+	const double Offset = GameState->GetServerWorldTimeSeconds() - GetWorld()->GetTimeSeconds();
+
+	// Snap on the first sample and after large corrections such as a hitch, otherwise drift towards the new offset over a second
+	if ( !bServerClockSynced || FMath::Abs( Offset - ServerClockOffset ) > 0.5 )
+	{
+		ServerClockOffset = Offset;
+		bServerClockSynced = true;
+		return;
+	}
+
+	ServerClockOffset += ( Offset - ServerClockOffset ) * ( 1.0 - FMath::Exp( -DeltaSeconds ) );
+}
+
+float ACapstoneCharacter::GetEstimatedServerTime() const
+{
+	const double LocalTime = GetWorld()->GetTimeSeconds();
+	return bServerClockSynced ? LocalTime + ServerClockOffset : LocalTime;
+}
+
+float ACapstoneCharacter::GetRemoteViewDelay() const
+{
+	// The server time estimate arrives as late as the remote poses do, only the smoothing towards them is extra
+	const UCharacterMovementComponent* Movement = GetCharacterMovement();
+	return Movement->NetworkSmoothingMode == ENetworkSmoothingMode::Disabled ? 0.0f : Movement->NetworkSimulatedSmoothLocationTime;
+}
+
+void ACapstoneCharacter::Tick( float DeltaSeconds )
+{
+	Super::Tick( DeltaSeconds );
+
+	if ( bWeaponVisibilityDirty ) ApplyWeaponVisibility();
+
+	if ( HasAuthority() ) RecordPose();
+	else if ( IsLocallyControlled() ) UpdateServerClock( DeltaSeconds );
+
+	if ( PendingShots.Num() > 0 ) FlushPendingShots();
+}
+
+void ACapstoneCharacter::RecordPose()
+{
+	static const FName HeadBoneName( "head" );
+
+	FPoseSnapshot Snapshot;
+	Snapshot.Time = GetWorld()->GetTimeSeconds();
+	Snapshot.Location = GetCapsuleComponent()->GetComponentLocation();
+	Snapshot.Rotation = GetCapsuleComponent()->GetComponentQuat();
+	Snapshot.HeadLocation = GetMesh()->GetSocketLocation( HeadBoneName );
+	PoseHistory.Record( Snapshot );
+}
+
+void ACapstoneCharacter::NotifyCombat()
+{
+	LastCombatTime = GetWorld()->GetTimeSeconds();
+}
+
+bool ACapstoneCharacter::IsInCombat( const float Window ) const
+{
+	return LastCombatTime >= 0.0f && GetWorld()->GetTimeSeconds() - LastCombatTime <= Window;
+}
+
+void ACapstoneCharacter::FlushPendingShots()
+{
+	HandleFire( PendingShots );
+	PendingShots.Reset();
+}
+
+void ACapstoneCharacter::HandleFire_Implementation( const TArray<FPredictedShot>& Shots )
+{
+	CAPSTONE_SERVER_RPC( STAT_ServerRPC_HandleFire );
+	ULoadTestSubsystem::RecordRPC( this );
+
+	TArray<uint16> RejectedKeys;
+
+	// Allow a little jitter in client timestamps, but never more shots than the fire rate permits
+	const float MinShotInterval = FireRate * 0.9f;
+	const FVector ServerMuzzle = GetActorLocation() + ( GetActorRotation().Vector() * 100.0f ) + ( GetActorUpVector() * 50.0f );
+	const float ServerTime = GetWorld()->GetTimeSeconds();
+
+	// Shots older than the longest rewind could only have been back-dated to hit where targets used to be
+	const ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	const float OldestShotTime = ServerTime - ( LagCompensation ? LagCompensation->GetMaxRewindSeconds() : 0.0f );
+	LastAcceptedShotTime = FMath::Max( LastAcceptedShotTime, OldestShotTime - MinShotInterval );
+
+	// No more shots than the fire rate allows since the last batch arrived, plus one for batches arriving unevenly
+	LastAcceptedBatchTime = FMath::Max( LastAcceptedBatchTime, OldestShotTime - MinShotInterval );
+	const int32 MaxShots = FMath::CeilToInt( ( ServerTime - LastAcceptedBatchTime ) / FMath::Max( MinShotInterval, KINDA_SMALL_NUMBER ) ) + 1;
+	bool bAcceptedShot = false;
+
+	for ( int32 Index = 0; Index < Shots.Num(); ++Index )
+	{
+		const FPredictedShot& Shot = Shots[Index];
+		if ( IsDead() || Index >= MaxShots )
+		{
+			RejectedKeys.Add( Shot.PredictionKey );
+			continue;
+		}
+
+		const bool bFromFuture = Shot.ClientTime > ServerTime + MinShotInterval;
+		const bool bTooOld = Shot.ClientTime < OldestShotTime;
+		const bool bTooSoon = Shot.ClientTime - LastAcceptedShotTime < MinShotInterval;
+		if ( bFromFuture || bTooOld || bTooSoon )
+		{
+			RejectedKeys.Add( Shot.PredictionKey );
+			continue;
+		}
+
+		LastAcceptedShotTime = Shot.ClientTime;
+		bAcceptedShot = true;
+		NotifyCombat();
+
+		// Hits are rewound to the poses the client saw, which it may not claim are older than the rewind window allows
+		const float ViewTime = FMath::Clamp( Shot.ViewTime, OldestShotTime, Shot.ClientTime );
+
+		// Trust the client's muzzle only while it agrees with where the server thinks the character is
+		const bool bOriginValid = FVector::DistSquared( Shot.Origin, ServerMuzzle ) <= FMath::Square( MaxShotOriginError );
+		SpawnProjectile( bOriginValid ? FVector( Shot.Origin ) : ServerMuzzle, Shot.Direction, Shot.PredictionKey, ServerTime - ViewTime );
+	}
+
+	if ( bAcceptedShot ) LastAcceptedBatchTime = ServerTime;
+	if ( RejectedKeys.Num() > 0 ) Client_RejectShots( RejectedKeys );
+}
+
+void ACapstoneCharacter::Client_RejectShots_Implementation( const TArray<uint16>& PredictionKeys )
+{
+	if ( AProjectileBatchManager* ProjectileManager = AProjectileBatchManager::Get( this ) )
+	{
+		ProjectileManager->RejectPredictedProjectiles( this, PredictionKeys );
+	}
+}
+
+void ACapstoneCharacter::SpawnProjectile( const FVector& Origin, const FVector& Direction, const uint16 PredictionKey, const float RewindSeconds )
+{
+	if ( CurrentWeapon && CurrentWeapon->FireMode == EWeaponFireMode::HitScan )
+	{
+		if ( UHitScanSubsystem* HitScan = GetWorld()->GetSubsystem<UHitScanSubsystem>() )
+		{
+			HitScan->Fire( CurrentWeapon, this, Origin, Direction, PredictionKey, RewindSeconds );
+		}
+	}
+	else if ( bUseBatchedProjectiles )
+	{
+		if ( AProjectileBatchManager* ProjectileManager = AProjectileBatchManager::Get( this ) )
+		{
+			ProjectileManager->FireProjectile( ProjectileClass, Origin, Direction, this, PredictionKey, RewindSeconds );
+		}
+	}
+	else if ( UProjectilePoolSubsystem* ProjectilePool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>() )
+	{
+		ProjectilePool->AcquireProjectile( ProjectileClass, FTransform( Direction.Rotation(), Origin ), this, this );
+	}
 }
 
 void ACapstoneCharacter::EnableAim()
@@ -390,6 +1129,20 @@ void ACapstoneCharacter::DisableAim()
 	FPSpring->SocketOffset.Z = 0.0f;
 }
 
+void ACapstoneCharacter::Jump()
+{
+	UInputReplaySubsystem::Record( this, EReplayInput::JumpStart );
+
+	Super::Jump();
+}
+
+void ACapstoneCharacter::StopJumping()
+{
+	UInputReplaySubsystem::Record( this, EReplayInput::JumpStop );
+
+	Super::StopJumping();
+}
+
 UCameraComponent* ACapstoneCharacter::GetCamera()
 {
 	if ( FollowCamera->IsActive() ) return FollowCamera;
@@ -398,6 +1151,8 @@ UCameraComponent* ACapstoneCharacter::GetCamera()
 
 void ACapstoneCharacter::SwitchCameras()
 {
+	UInputReplaySubsystem::Record( this, EReplayInput::SwitchCamera );
+
 	FollowCamera->SetActive( !FollowCamera->IsActive() );
 	FPSCamera->SetActive( !FPSCamera->IsActive() );
 }
\ No newline at end of file
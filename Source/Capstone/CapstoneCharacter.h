@@ -5,6 +5,10 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Logging/LogMacros.h"
+#include "Engine/StreamableManager.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "PoseHistory.h"
+#include "Weapon.h"
 #include "CapstoneCharacter.generated.h"
 
 class USpringArmComponent;
@@ -16,11 +20,83 @@ struct FInputActionValue;
 DECLARE_LOG_CATEGORY_EXTERN(LogTemplateCharacter, Log, All);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams( FCurrentWeaponChangeDelegate, class AWeapon*, CurrentWeapon, const class AWeapon*, OldWeapon );
 
+// A shot fired and predicted by the owning client, sent to the server in batches for confirmation
+USTRUCT()
+struct FPredictedShot
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint16 PredictionKey = 0;
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	// Estimated server time at which the client fired
+	UPROPERTY()
+	float ClientTime = 0.0f;
+
+	// Server time of the remote poses the client was looking at when it fired, the time hits are rewound to
+	UPROPERTY()
+	float ViewTime = 0.0f;
+};
+
+// One weapon of a character's loadout
+USTRUCT()
+struct FLoadoutEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	class AWeapon* Weapon = nullptr;
+
+	// Position in ACapstoneCharacter::Weapons, fast arrays do not keep their order on clients
+	UPROPERTY()
+	int32 Slot = 0;
+};
+
+// Delta serialized loadout, a change only sends the entries that changed
+USTRUCT()
+struct FWeaponLoadout : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FLoadoutEntry> Items;
+
+	UPROPERTY( NotReplicated )
+	class ACapstoneCharacter* Owner = nullptr;
+
+	void PostReplicatedReceive( const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters );
+
+	bool NetDeltaSerialize( FNetDeltaSerializeInfo& DeltaParms );
+};
+
+template<>
+struct TStructOpsTypeTraits<FWeaponLoadout> : public TStructOpsTypeTraitsBase2<FWeaponLoadout>
+{
+	enum { WithNetDeltaSerializer = true };
+};
+
 UCLASS(config=Game)
 class ACapstoneCharacter : public ACharacter
 {
 	GENERATED_BODY()
 
+	// Load test bots press the fire button like a player would
+	friend class ULoadTestSubsystem;
+	friend struct FCapstoneBenchmarks;
+
+	// Input replays call the same handlers the input bindings do
+	friend class UInputReplaySubsystem;
+
+	// Fill the pose history with known poses and fire shots straight into HandleFire
+	friend class FCapstoneLagCompensationTest;
+	friend class FCapstoneHandleFireTest;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Animation", meta = (AllowPrivateAccess = "true" ))
 	TArray<UAnimMontage*> EquippingAnimations;
 
@@ -94,22 +170,34 @@ public:
 	ACapstoneCharacter();
 
 	void GetLifetimeReplicatedProps( TArray<FLifetimeProperty>& OutLifetimeProps ) const override;
+
+	/** Times the replication setup of the character for its per-character CSV stats, see RecordReplicationCost.*/
+	virtual void PreReplication( IRepChangedPropertyTracker& ChangedPropertyTracker ) override;
+
+	/** Adds to this frame's replication time and bytes of the character in the CSV profile, one column each per character.*/
+	void RecordReplicationCost( const uint64 Cycles, const int32 Bytes );
+
+	/** Measures the size of every server RPC sent for "stat Capstone" and the Capstone trace channel.*/
+	virtual bool CallRemoteFunction( UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack ) override;
 	
-	///** Getter for Max Health.*/
-	//UFUNCTION( BlueprintPure, Category = "Health" )
-	//FORCEINLINE float GetMaxHealth() const { return MaxHealth; }
+	/** Getter for Max Health.*/
+	UFUNCTION( BlueprintPure, Category = "Health" )
+	FORCEINLINE float GetMaxHealth() const { return MaxHealth; }
 
-	///** Getter for Current Health.*/
-	//UFUNCTION( BlueprintPure, Category = "Health" )
-	//FORCEINLINE float GetCurrentHealth() const { return CurrentHealth; }
+	/** Getter for Current Health.*/
+	UFUNCTION( BlueprintPure, Category = "Health" )
+	FORCEINLINE float GetCurrentHealth() const { return CurrentHealth; }
 
-	///** Setter for Current Health. Clamps the value between 0 and MaxHealth and calls OnHealthUpdate. Should only be called on the server.*/
-	//UFUNCTION( BlueprintCallable, Category = "Health" )
-	//void SetCurrentHealth( float healthValue );
+	UFUNCTION( BlueprintPure, Category = "Health" )
+	FORCEINLINE bool IsDead() const { return CurrentHealth <= 0.0f; }
 
-	///** Event for taking damage. Overridden from APawn.*/
-	//UFUNCTION( BlueprintCallable, Category = "Health" )
-	//float TakeDamage( float DamageTaken, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser ) override;
+	/** Setter for Current Health. Clamps the value between 0 and MaxHealth and calls OnHealthUpdate. Should only be called on the server.*/
+	UFUNCTION( BlueprintCallable, Category = "Health" )
+	void SetCurrentHealth( float healthValue );
+
+	/** Event for taking damage. Overridden from APawn. Damage is queued with ADamageBatchManager and applied at the end of the frame.*/
+	UFUNCTION( BlueprintCallable, Category = "Health" )
+	float TakeDamage( float DamageTaken, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser ) override;
 
 	UFUNCTION( BlueprintCallable, Category = "Character" )
 	void Equip( const int32 index );
@@ -132,42 +220,120 @@ protected:
 	void NextTool();
 	void PrevTool();
 
+	/** Overridden so jumps are recorded by UInputReplaySubsystem like every other input.*/
+	virtual void Jump() override;
+	virtual void StopJumping() override;
+
 protected:
-	// Weapons the character spawns with
+	// Weapons the character spawns with. Only the current one is spawned in BeginPlay, the rest on their first Equip
 	UPROPERTY(EditDefaultsOnly, Category = "Configurations")
-	TArray<TSubclassOf<class AWeapon>> DefaultWeapons;
+	TArray<TSoftClassPtr<class AWeapon>> DefaultWeapons;
+
+	/** How many slots on each side of the current one get their weapon class loaded ahead of being equipped.*/
+	UPROPERTY( EditDefaultsOnly, Category = "Configurations" )
+	int32 PrewarmWeaponCount = 1;
 
 	UFUNCTION()
 	void OnRep_CurrentWeapon( const class AWeapon* OldWeapon );
 
+	/** Attaches a weapon to the weapon socket for good. Switching weapons afterwards only changes their visibility.*/
+	void AttachWeapon( class AWeapon* Weapon );
+
+	/** Shows the current weapon and hides the rest. Runs at most once per frame no matter how often the weapon changed.*/
+	void ApplyWeaponVisibility();
+
+	// Set when CurrentWeapon changed since the last ApplyWeaponVisibility
+	bool bWeaponVisibilityDirty = false;
+
+	/** Assigns CurrentWeapon and marks it dirty for push-model replication.*/
+	void SetCurrentWeapon( class AWeapon* NewWeapon );
+
+	/** Puts a spawned weapon into its loadout slot. Server only.*/
+	void AddToLoadout( class AWeapon* NewWeapon, const int32 Slot );
+
+	/** Spawns the weapon of Slot, loading its class asynchronously first if needed. Server only.*/
+	void StreamWeapon( const int32 Slot );
+
+	void OnWeaponClassLoaded( const int32 Slot );
+
+	/** Loads the weapon classes next to the current slot so equipping them does not wait on disk.*/
+	void PrewarmWeapons();
+
+	/** Gets the projectile batch manager or projectile pool of the world ready for ProjectileClass. Server only.*/
+	void RegisterProjectileClass();
+
+	/** Starts loading the weapon class of Slot without spawning anything.*/
+	void LoadWeaponClass( const int32 Slot, FStreamableDelegate Delegate = FStreamableDelegate() );
+
+	// Keeps loaded weapon classes resident, one per loadout slot
+	TArray<TSharedPtr<FStreamableHandle>> WeaponLoadHandles;
+
+	/** Replicated loadout. Weapons mirrors it in slot order on every machine.*/
+	UPROPERTY( Replicated )
+	FWeaponLoadout Loadout;
+
+	/** Equips a loadout slot on the server, spawning its weapon first if it was never equipped before.*/
 	UFUNCTION(Server, Reliable)
-	void Server_SetWeapon( class AWeapon* newWeapon );
-	void Server_SetWeapon_Implementation( class AWeapon* newWeapon );
+	void Server_Equip( const int32 index );
+	void Server_Equip_Implementation( const int32 index );
+
+	/** Makes slot index the current weapon, spawning it first if it was never equipped before. Server only.*/
+	void EquipSlot( const int32 index );
 
-	///** The player's maximum health. This is the highest value of their health can be. This value is a value of the player's health, which starts at when spawned.*/
-	//UPROPERTY( EditDefaultsOnly, Category = "Health" )
-	//float MaxHealth;
+	/** Applies the player's adjustments to the weapon in Slot. Offsets are clamped to MaxCustomizationOffset.*/
+	UFUNCTION( Server, Reliable, BlueprintCallable, Category = "Character" )
+	void Server_CustomizeWeapon( const int32 Slot, const FWeaponCustomization& Customization );
+	void Server_CustomizeWeapon_Implementation( const int32 Slot, const FWeaponCustomization& Customization );
 
-	///** The player's current health. When reduced to 0, they are considered dead.*/
-	//UPROPERTY( ReplicatedUsing = OnRep_CurrentHealth )
-	//float CurrentHealth;
+	/** Furthest a player may move a weapon or its sights away from the class placement, in centimeters.*/
+	UPROPERTY( EditDefaultsOnly, Category = "Configurations" )
+	float MaxCustomizationOffset = 20.0f;
+
+	/** The player's maximum health. This is the highest value of their health can be. This value is a value of the player's health, which starts at when spawned.*/
+	UPROPERTY( EditDefaultsOnly, Category = "Health" )
+	float MaxHealth;
+
+	/** The player's current health. When reduced to 0, they are considered dead. Push-model, dirty only when it changes.*/
+	UPROPERTY( ReplicatedUsing = OnRep_CurrentHealth )
+	float CurrentHealth;
 
 	/** RepNotify for changes made to current health.*/
-	//UFUNCTION()
-	//void OnRep_CurrentHealth();
+	UFUNCTION()
+	void OnRep_CurrentHealth();
 
 	/** Response to health being updated. Called on the server immediately after modification, and on clients in response to a RepNotify*/
-	//void OnHealthUpdate();
+	void OnHealthUpdate();
+
+	UPROPERTY( ReplicatedUsing = OnRep_Ragdoll )
+	bool bIsRagdoll;
+
+	UFUNCTION()
+	void OnRep_Ragdoll();
+
+	// True between StartDeath and Revive on this machine, a respawn only has a death to undo if one was played
+	bool bDeathStarted = false;
+
+	// True while the character waits in UCharacterPoolSubsystem
+	bool bPooled = false;
+
+	// Customizations restored after seamless travel for weapons not spawned yet, by slot
+	TMap<int32, FWeaponCustomization> RestoredCustomizations;
 
-	//UPROPERTY( ReplicatedUsing = OnRep_Ragdoll )
-	//bool bIsRagdoll;
+	/** Played instead of a ragdoll when the character dies far away or the ragdoll budget is spent.*/
+	UPROPERTY( EditDefaultsOnly, Category = "Health" )
+	class UAnimSequence* DeathAnimation;
 
-	//UFUNCTION()
-	//void OnRep_Ragdoll();
+	/** Simplified physics asset swapped in for the ragdoll. Keeps the mesh's own asset if not set.*/
+	UPROPERTY( EditDefaultsOnly, Category = "Health" )
+	class UPhysicsAsset* RagdollPhysicsAsset;
 
 	UPROPERTY( EditDefaultsOnly, Category = "Gameplay|Projectile" )
 	TSubclassOf<class ANetworkProjectile > ProjectileClass;
 
+	/** If true, shots are simulated as data by AProjectileBatchManager instead of spawning pooled projectile actors.*/
+	UPROPERTY( EditDefaultsOnly, Category = "Gameplay|Projectile" )
+	bool bUseBatchedProjectiles = true;
+
 	/** Delay between shots in seconds. Used to control fire rate for your test projectile, but also to prevent an overflow of server functions from binding SpawnProjectile directly to input.*/
 	UPROPERTY( EditDefaultsOnly, Category = "Gameplay" )
 	float FireRate;
@@ -183,9 +349,58 @@ protected:
 	UFUNCTION( BlueprintCallable, Category = "Gameplay" )
 	void StopFire();
 
-	/** Server function for spawning projectiles.*/
-	UFUNCTION( Server, Reliable )
-	void HandleFire();
+	/** Fires a single shot. Owning clients predict it locally and queue it for the server.*/
+	void FireShot();
+
+	/** Server function for spawning projectiles. Receives every shot the client fired since its last send.*/
+	UFUNCTION( Server, Unreliable )
+	void HandleFire( const TArray<FPredictedShot>& Shots );
+
+	/** Tells the owning client which of its predicted shots the server refused.*/
+	UFUNCTION( Client, Unreliable )
+	void Client_RejectShots( const TArray<uint16>& PredictionKeys );
+
+	/** Spawns the authoritative projectile for a shot, or traces it if the current weapon is hit-scan. Server only. RewindSeconds is how far targets are rewound for its hits.*/
+	void SpawnProjectile( const FVector& Origin, const FVector& Direction, const uint16 PredictionKey, const float RewindSeconds );
+
+	/** Sends the queued shots to the server, at most once per frame.*/
+	void FlushPendingShots();
+
+	/** Distance the client muzzle may be away from the server's before the server fires from its own muzzle instead.*/
+	UPROPERTY( EditDefaultsOnly, Category = "Gameplay" )
+	float MaxShotOriginError = 150.0f;
+
+	// Shots fired since the last HandleFire call
+	TArray<FPredictedShot> PendingShots;
+
+	// Key of the last predicted shot, 0 is reserved for unpredicted shots
+	uint16 LastPredictionKey = 0;
+
+	// Client timestamp of the last shot the server accepted, seeded from server time so it never lags the rewind window
+	float LastAcceptedShotTime = -1.0f;
+
+	// Server time at which the last batch with an accepted shot arrived, bounds how many shots the next batch may hold
+	float LastAcceptedBatchTime = -1.0f;
+
+	/** Follows the game state's server time slowly, its estimate jumps every time it is corrected. Owning clients only.*/
+	void UpdateServerClock( float DeltaSeconds );
+
+	/** Server time as the owning client estimates it, without the jumps of the game state's estimate.*/
+	float GetEstimatedServerTime() const;
+
+	/** How far behind the estimated server time remote characters are drawn, the smoothing of their replicated movement.*/
+	float GetRemoteViewDelay() const;
+
+	// Names of the per-character CSV stats, made on the first capture
+	FName CsvReplicationTimeStat;
+	FName CsvBytesSentStat;
+
+	// Offset from local to server world time, valid once bServerClockSynced is set
+	double ServerClockOffset = 0.0;
+	bool bServerClockSynced = false;
+
+	// Local world time the character last fired or was seen firing
+	float LastCombatTime = -1.0f;
 
 	/** A timer handle used for providing the fire rate delay in-between spawns.*/
 	FTimerHandle FiringTimer;
@@ -197,9 +412,23 @@ protected:
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	
-	// To add mapping context
 	virtual void BeginPlay();
 
+	/** Adds the mapping context and resets the camera mode. Runs on every possession, pooled characters are possessed many times.*/
+	virtual void NotifyControllerChanged() override;
+
+	/** Restores the loadout ACapstonePlayerState carried over seamless travel, if there is one.*/
+	virtual void PossessedBy( AController* NewController ) override;
+
+	virtual void EndPlay( const EEndPlayReason::Type EndPlayReason ) override;
+
+	virtual void Tick( float DeltaSeconds ) override;
+
+	/** Hitbox history recorded every server tick for lag compensation.*/
+	FPoseHistory PoseHistory;
+
+	void RecordPose();
+
 public:
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
@@ -207,10 +436,38 @@ public:
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 	FORCEINLINE class UCameraComponent* GetFPSCamera() const { return FPSCamera; }
 	virtual UCameraComponent* GetCamera();
+	FORCEINLINE const FPoseHistory& GetPoseHistory() const { return PoseHistory; }
+
+	/** Marks the character as in combat, e.g. because it fired. Used to keep fighting characters significant.*/
+	void NotifyCombat();
+
+	/** True if the character was in combat within the last Window seconds.*/
+	bool IsInCombat( const float Window ) const;
+
+	/** Takes the character out of play for UCharacterPoolSubsystem: hides it, stops it and puts its weapons away. Server only.*/
+	void DeactivateToPool();
+
+	/** Puts a pooled character back into play at SpawnTransform with full health, reset movement and its first weapon in hand. Server only.*/
+	void ActivateFromPool( const FTransform& SpawnTransform );
 
-	UPROPERTY(VisibleInstanceOnly, BlueprintReadWrite, Replicated, Category = "State")
+	FORCEINLINE bool IsPooled() const { return bPooled; }
+
+	/** Saves the spawned weapons, their customization and the slot in hand into ACapstonePlayerState ahead of seamless travel. Server only.*/
+	void SaveLoadout();
+
+	/** Adds the character and its spawned weapons to the actors kept through seamless travel.*/
+	void AddSeamlessTravelActors( TArray<AActor*>& ActorList );
+
+	/** Registers a character kept through seamless travel, and its weapons, with the subsystems of the new map. Server only.*/
+	void OnTravelledToWorld();
+
+	// Read only for Blueprints, it mirrors the replicated Loadout and anything written to it would never replicate
+	UPROPERTY(VisibleInstanceOnly, BlueprintReadOnly, Category = "State")
 	TArray<class AWeapon*> Weapons;
 
+	/** Rebuilds Weapons from the replicated loadout. Called on clients when the loadout changes.*/
+	void OnLoadoutReplicated();
+
 	UPROPERTY( VisibleInstanceOnly, BlueprintReadWrite, ReplicatedUsing = OnRep_CurrentWeapon, Category = "State" )
 	class AWeapon* CurrentWeapon;
 
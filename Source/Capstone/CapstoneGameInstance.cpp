@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneGameInstance.h"
+#include "CapstoneLevelStreamingSubsystem.h"
+
+#include "Blueprint/UserWidget.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "MoviePlayer.h"
+#include "TimerManager.h"
+
+void UCapstoneGameInstance::Init()
+{
+	Super::Init();
+
+	if ( IsRunningDedicatedServer() ) return;
+
+	// Loaded once and kept, the widget has to exist before the map it covers starts loading
+	LoadedWidgetClass = LoadingScreenWidgetClass.LoadSynchronous();
+
+	PreLoadMapHandle = FCoreUObjectDelegates::PreLoadMap.AddUObject( this, &UCapstoneGameInstance::BeginLoadingScreen );
+	PostLoadMapHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject( this, &UCapstoneGameInstance::EndLoadingScreen );
+}
+
+void UCapstoneGameInstance::Shutdown()
+{
+	FCoreUObjectDelegates::PreLoadMap.Remove( PreLoadMapHandle );
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove( PostLoadMapHandle );
+
+	Super::Shutdown();
+}
+
+void UCapstoneGameInstance::BeginLoadingScreen( const FString& MapName )
+{
+	if ( !LoadedWidgetClass ) return;
+
+	HideLoadingScreen();
+
+	// The movie player keeps drawing on its own thread while the game thread is busy loading the map
+	UUserWidget* Widget = CreateWidget<UUserWidget>( this, LoadedWidgetClass );
+	if ( !Widget ) return;
+
+	FLoadingScreenAttributes Attributes;
+	Attributes.bAutoCompleteWhenLoadingCompletes = true;
+	Attributes.MinimumLoadingScreenDisplayTime = MinimumLoadingScreenDisplayTime;
+	Attributes.WidgetLoadingScreen = Widget->TakeWidget();
+	GetMoviePlayer()->SetupLoadingScreen( Attributes );
+}
+
+void UCapstoneGameInstance::EndLoadingScreen( UWorld* LoadedWorld )
+{
+	if ( !LoadedWidgetClass || !LoadedWorld || LoadedWorld != GetWorld() ) return;
+
+	// The persistent level is in, keep covering the sublevels still streaming
+	LoadingScreenWidget = CreateWidget<UUserWidget>( this, LoadedWidgetClass );
+	if ( LoadingScreenWidget ) LoadingScreenWidget->AddToViewport( 1000 );
+
+	StreamingCompleteTime = -1.0f;
+	LoadedWorld->GetTimerManager().SetTimer( LoadingScreenTimer, this, &UCapstoneGameInstance::UpdateLoadingScreen, 0.1f, true );
+}
+
+void UCapstoneGameInstance::UpdateLoadingScreen()
+{
+	UWorld* World = GetWorld();
+	const UCapstoneLevelStreamingSubsystem* Streaming = World ? World->GetSubsystem<UCapstoneLevelStreamingSubsystem>() : nullptr;
+	if ( Streaming && !Streaming->IsStreamingComplete() ) return;
+
+	const float Now = World ? World->GetTimeSeconds() : 0.0f;
+	if ( StreamingCompleteTime < 0.0f ) StreamingCompleteTime = Now;
+
+	const APlayerController* PlayerController = GetFirstLocalPlayerController( World );
+	if ( ( PlayerController && PlayerController->GetPawn() ) || Now - StreamingCompleteTime >= PawnWaitTime ) HideLoadingScreen();
+}
+
+void UCapstoneGameInstance::HideLoadingScreen()
+{
+	if ( UWorld* World = GetWorld() ) World->GetTimerManager().ClearTimer( LoadingScreenTimer );
+
+	if ( LoadingScreenWidget ) LoadingScreenWidget->RemoveFromParent();
+	LoadingScreenWidget = nullptr;
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/GameInstance.h"
+#include "CapstoneGameInstance.generated.h"
+
+class UUserWidget;
+
+/**
+ * Shows UI/LoadingScreen for the whole of a map change: through the movie player while the persistent level loads,
+ * then in the viewport until UCapstoneLevelStreamingSubsystem has streamed every sublevel and the player is spawned.
+ * Enabled through GameInstanceClass in DefaultEngine.ini.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API UCapstoneGameInstance : public UGameInstance
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Init() override;
+	virtual void Shutdown() override;
+
+protected:
+	void BeginLoadingScreen( const FString& MapName );
+	void EndLoadingScreen( UWorld* LoadedWorld );
+
+	/** Removes the loading screen once streaming is done and the local player has a pawn, or gave up waiting for one.*/
+	void UpdateLoadingScreen();
+
+	void HideLoadingScreen();
+
+	UPROPERTY( config )
+	TSoftClassPtr<UUserWidget> LoadingScreenWidgetClass;
+
+	/** Seconds the loading screen waits for a pawn after streaming, maps like the title screen never spawn one.*/
+	UPROPERTY( config )
+	float PawnWaitTime = 5.0f;
+
+	/** Shortest time the movie player shows the loading screen, so a fast load does not flash it.*/
+	UPROPERTY( config )
+	float MinimumLoadingScreenDisplayTime = 0.5f;
+
+	UPROPERTY()
+	TSubclassOf<UUserWidget> LoadedWidgetClass;
+
+	UPROPERTY()
+	UUserWidget* LoadingScreenWidget;
+
+	FTimerHandle LoadingScreenTimer;
+
+	// World time streaming finished at, negative while it has not
+	float StreamingCompleteTime = -1.0f;
+
+	FDelegateHandle PreLoadMapHandle;
+	FDelegateHandle PostLoadMapHandle;
+};
@@ -2,7 +2,12 @@
 
 #include "CapstoneGameMode.h"
 #include "CapstoneCharacter.h"
+#include "CapstonePlayerState.h"
+#include "CharacterPoolSubsystem.h"
+#include "CapstoneLevelStreamingSubsystem.h"
 #include "UObject/ConstructorHelpers.h"
+#include "EngineUtils.h"
+#include "TimerManager.h"
 
 ACapstoneGameMode::ACapstoneGameMode()
 {
@@ -15,4 +20,149 @@ ACapstoneGameMode::ACapstoneGameMode()
 
 	static ConstructorHelpers::FClassFinder<APlayerController> NetworkPlayerBPClass( TEXT( "/Game/MultiplayerChat/BP_NetworkPlayerController" ) );
 	if ( NetworkPlayerBPClass.Class != NULL ) PlayerControllerClass = NetworkPlayerBPClass.Class;
+
+	PlayerStateClass = ACapstonePlayerState::StaticClass();
+
+	// Keep connections, controllers and player states across ServerTravel instead of having every client reconnect
+	bUseSeamlessTravel = true;
+}
+
+void ACapstoneGameMode::StartPlay()
+{
+	if ( UCharacterPoolSubsystem* CharacterPool = GetWorld()->GetSubsystem<UCharacterPoolSubsystem>() )
+	{
+		if ( DefaultPawnClass && DefaultPawnClass->IsChildOf<ACapstoneCharacter>() ) CharacterPool->Prewarm( DefaultPawnClass.Get(), 0 );
+	}
+
+	Super::StartPlay();
+}
+
+void ACapstoneGameMode::HandleStartingNewPlayer_Implementation( APlayerController* NewPlayer )
+{
+	// The subsystem calls this again once the player is ready
+	UCapstoneLevelStreamingSubsystem* Streaming = GetWorld()->GetSubsystem<UCapstoneLevelStreamingSubsystem>();
+	if ( Streaming && !Streaming->IsPlayerReady( NewPlayer ) )
+	{
+		Streaming->WaitForPlayer( NewPlayer );
+		return;
+	}
+
+	Super::HandleStartingNewPlayer_Implementation( NewPlayer );
+}
+
+APawn* ACapstoneGameMode::SpawnDefaultPawnAtTransform_Implementation( AController* NewPlayer, const FTransform& SpawnTransform )
+{
+	UClass* PawnClass = GetDefaultPawnClassForController( NewPlayer );
+	UCharacterPoolSubsystem* CharacterPool = GetWorld()->GetSubsystem<UCharacterPoolSubsystem>();
+	if ( !CharacterPool || !PawnClass || !PawnClass->IsChildOf<ACapstoneCharacter>() ) return Super::SpawnDefaultPawnAtTransform_Implementation( NewPlayer, SpawnTransform );
+
+	// A player back from seamless travel gets its own character and weapons, the pool is only for everyone else
+	ACapstonePlayerState* CapstonePlayerState = NewPlayer ? NewPlayer->GetPlayerState<ACapstonePlayerState>() : nullptr;
+	ACapstoneCharacter* Character = CapstonePlayerState ? CapstonePlayerState->ConsumeTravellingCharacter() : nullptr;
+	if ( IsValid( Character ) && Character->GetClass() == PawnClass )
+	{
+		Character->ActivateFromPool( SpawnTransform );
+	}
+	else
+	{
+		// This map may spawn another character class for the player, then the old one has no use here
+		if ( IsValid( Character ) ) Character->Destroy();
+		Character = CharacterPool->AcquireCharacter( PawnClass, SpawnTransform );
+	}
+
+	if ( Character ) Character->SetInstigator( GetInstigator() );
+
+	return Character;
+}
+
+void ACapstoneGameMode::GetSeamlessTravelActorList( bool bToTransition, TArray<AActor*>& ActorList )
+{
+	// Called once leaving the old map, while the characters are still around. The character leaves play with its
+	// loadout saved and travels pooled, so nothing falls through the transition map or has to be spawned again
+	if ( bToTransition )
+	{
+		for ( FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It )
+		{
+			APlayerController* PlayerController = It->Get();
+			ACapstoneCharacter* Character = PlayerController ? Cast<ACapstoneCharacter>( PlayerController->GetPawn() ) : nullptr;
+			ACapstonePlayerState* CapstonePlayerState = PlayerController ? PlayerController->GetPlayerState<ACapstonePlayerState>() : nullptr;
+			if ( !Character || !CapstonePlayerState ) continue;
+
+			Character->SaveLoadout();
+			PlayerController->UnPossess();
+			Character->DeactivateToPool();
+			CapstonePlayerState->SetTravellingCharacter( Character );
+		}
+	}
+
+	// Called again in the transition map, actors have to be in both lists to reach the new map
+	for ( TActorIterator<ACapstonePlayerState> It( GetWorld() ); It; ++It )
+	{
+		ACapstoneCharacter* Character = It->GetTravellingCharacter();
+		if ( IsValid( Character ) ) Character->AddSeamlessTravelActors( ActorList );
+	}
+
+	Super::GetSeamlessTravelActorList( bToTransition, ActorList );
+}
+
+void ACapstoneGameMode::PostSeamlessTravel()
+{
+	// Player states of the last map, this map's game state may not know about them yet
+	for ( TActorIterator<ACapstonePlayerState> It( GetWorld() ); It; ++It )
+	{
+		ACapstoneCharacter* Character = It->GetTravellingCharacter();
+		if ( IsValid( Character ) ) Character->OnTravelledToWorld();
+	}
+
+	Super::PostSeamlessTravel();
+}
+
+void ACapstoneGameMode::Logout( AController* Exiting )
+{
+	// A player that leaves before it is restarted never claims the character it travelled with
+	ACapstonePlayerState* CapstonePlayerState = Exiting ? Exiting->GetPlayerState<ACapstonePlayerState>() : nullptr;
+	ACapstoneCharacter* Character = CapstonePlayerState ? CapstonePlayerState->ConsumeTravellingCharacter() : nullptr;
+	if ( IsValid( Character ) )
+	{
+		UCharacterPoolSubsystem* CharacterPool = GetWorld()->GetSubsystem<UCharacterPoolSubsystem>();
+		if ( CharacterPool ) CharacterPool->ReleaseCharacter( Character );
+		else Character->Destroy();
+	}
+
+	Super::Logout( Exiting );
+}
+
+void ACapstoneGameMode::RespawnPlayer( AController* Controller )
+{
+	if ( !Controller ) return;
+
+	if ( APawn* OldPawn = Controller->GetPawn() )
+	{
+		Controller->UnPossess();
+
+		UCharacterPoolSubsystem* CharacterPool = GetWorld()->GetSubsystem<UCharacterPoolSubsystem>();
+		ACapstoneCharacter* OldCharacter = Cast<ACapstoneCharacter>( OldPawn );
+		if ( CharacterPool && OldCharacter ) CharacterPool->ReleaseCharacter( OldCharacter );
+		else OldPawn->Destroy();
+	}
+
+	RestartPlayer( Controller );
+}
+
+void ACapstoneGameMode::NotifyKilled( ACapstoneCharacter* Victim )
+{
+	AController* Controller = Victim ? Victim->GetController() : nullptr;
+	if ( !Controller || RespawnDelay < 0.0f ) return;
+
+	FTimerHandle RespawnTimer;
+	const FTimerDelegate RespawnDelegate = FTimerDelegate::CreateUObject( this, &ACapstoneGameMode::RespawnKilledPlayer, TWeakObjectPtr<AController>( Controller ), TWeakObjectPtr<ACapstoneCharacter>( Victim ) );
+	GetWorldTimerManager().SetTimer( RespawnTimer, RespawnDelegate, FMath::Max( RespawnDelay, KINDA_SMALL_NUMBER ), false );
+}
+
+void ACapstoneGameMode::RespawnKilledPlayer( TWeakObjectPtr<AController> Controller, TWeakObjectPtr<ACapstoneCharacter> Victim )
+{
+	// A Blueprint may have revived or replaced the pawn already
+	if ( !Controller.IsValid() || !Victim.IsValid() || Controller->GetPawn() != Victim.Get() || !Victim->IsDead() ) return;
+
+	RespawnPlayer( Controller.Get() );
 }
@@ -6,6 +6,8 @@
 #include "GameFramework/GameModeBase.h"
 #include "CapstoneGameMode.generated.h"
 
+class ACapstoneCharacter;
+
 UCLASS(minimalapi)
 class ACapstoneGameMode : public AGameModeBase
 {
@@ -13,7 +15,37 @@ class ACapstoneGameMode : public AGameModeBase
 
 public:
 	ACapstoneGameMode();
-};
 
+	/** Gives Controller a fresh pawn at a player start. A previous ACapstoneCharacter goes back to UCharacterPoolSubsystem instead of being destroyed.*/
+	UFUNCTION( BlueprintCallable, BlueprintAuthorityOnly, Category = "Game" )
+	void RespawnPlayer( AController* Controller );
+
+	/** Schedules the respawn of Victim's controller RespawnDelay seconds from now. Called by ADamageBatchManager on kills.*/
+	void NotifyKilled( ACapstoneCharacter* Victim );
+
+	/** Seconds between a player dying and being respawned from the pool. Negative leaves respawning to Blueprints.*/
+	UPROPERTY( EditDefaultsOnly, BlueprintReadOnly, Category = "Game" )
+	float RespawnDelay = 5.0f;
+
+protected:
+	/** Fills the character pool before anyone joins, so the first wave of respawns is served from it.*/
+	virtual void StartPlay() override;
 
+	/** Holds players at the ready-check of UCapstoneLevelStreamingSubsystem until their client has streamed the map in.*/
+	virtual void HandleStartingNewPlayer_Implementation( APlayerController* NewPlayer ) override;
 
+	/** Gives a player the ACapstoneCharacter it travelled with, or takes one out of UCharacterPoolSubsystem. Other pawn classes are spawned as usual.*/
+	virtual APawn* SpawnDefaultPawnAtTransform_Implementation( AController* NewPlayer, const FTransform& SpawnTransform ) override;
+
+	/** Saves every character's loadout into its ACapstonePlayerState on the way out of the map and takes the pooled character and its weapons along.*/
+	virtual void GetSeamlessTravelActorList( bool bToTransition, TArray<AActor*>& ActorList ) override;
+
+	/** Registers the characters that travelled in with this map before any player is restarted.*/
+	virtual void PostSeamlessTravel() override;
+
+	/** Returns the character a player travelled with but never claimed to the pool.*/
+	virtual void Logout( AController* Exiting ) override;
+
+	/** Respawns Controller unless it has been given another pawn than the dead one in the meantime.*/
+	void RespawnKilledPlayer( TWeakObjectPtr<AController> Controller, TWeakObjectPtr<ACapstoneCharacter> Victim );
+};
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneLevelStreamingSubsystem.h"
+
+#include "Engine/Level.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+
+DEFINE_LOG_CATEGORY( LogCapstoneStreaming );
+
+bool UCapstoneLevelStreamingSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UCapstoneLevelStreamingSubsystem::IsTickable() const
+{
+	return !bStreamingComplete || WaitingPlayers.Num() > 0;
+}
+
+TStatId UCapstoneLevelStreamingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT( UCapstoneLevelStreamingSubsystem, STATGROUP_Tickables );
+}
+
+void UCapstoneLevelStreamingSubsystem::OnWorldBeginPlay( UWorld& InWorld )
+{
+	Super::OnWorldBeginPlay( InWorld );
+
+	StreamingStartTime = FPlatformTime::Seconds();
+
+	for ( ULevelStreaming* Level : InWorld.GetStreamingLevels() )
+	{
+		if ( !Level || ( !bStreamAllSublevels && !Level->ShouldBeLoaded() ) ) continue;
+
+		StreamedLevels.Add( Level );
+
+		// Clients are told what to load by the server, see AGameModeBase::ReplicateStreamingStatus
+		if ( InWorld.GetNetMode() == NM_Client ) continue;
+
+		Level->bShouldBlockOnLoad = false;
+		Level->SetShouldBeLoaded( true );
+		Level->SetShouldBeVisible( true );
+	}
+
+	UE_LOG( LogCapstoneStreaming, Log, TEXT( "Streaming %d sublevels of %s" ), StreamedLevels.Num(), *InWorld.GetMapName() );
+}
+
+void UCapstoneLevelStreamingSubsystem::Tick( float DeltaTime )
+{
+	if ( !bStreamingComplete )
+	{
+		bStreamingComplete = !StreamedLevels.ContainsByPredicate( []( const ULevelStreaming* Level ) { return Level && !Level->IsLevelVisible(); } );
+
+		if ( bStreamingComplete )
+		{
+			UE_LOG( LogCapstoneStreaming, Log, TEXT( "Streaming finished in %.2f s" ), FPlatformTime::Seconds() - StreamingStartTime );
+		}
+	}
+
+	AGameModeBase* GameMode = GetWorld()->GetAuthGameMode();
+	if ( !GameMode ) return;
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	for ( int32 Index = WaitingPlayers.Num() - 1; Index >= 0; --Index )
+	{
+		FWaitingPlayer& Waiting = WaitingPlayers[Index];
+		APlayerController* Player = Waiting.Player.Get();
+		if ( !Player )
+		{
+			WaitingPlayers.RemoveAtSwap( Index, 1, false );
+			continue;
+		}
+
+		if ( IsPlayerReady( Player ) )
+		{
+			UE_LOG( LogCapstoneStreaming, Log, TEXT( "%s passed the ready-check after %.2f s" ), *Player->GetName(), Now - Waiting.StartTime );
+
+			WaitingPlayers.RemoveAtSwap( Index, 1, false );
+			GameMode->HandleStartingNewPlayer( Player );
+			continue;
+		}
+
+		if ( !Waiting.bWarned && Now - Waiting.StartTime > ReadyCheckWarningTime )
+		{
+			UE_LOG( LogCapstoneStreaming, Warning, TEXT( "%s is still streaming after %.0f s" ), *Player->GetName(), Now - Waiting.StartTime );
+			Waiting.bWarned = true;
+		}
+	}
+}
+
+bool UCapstoneLevelStreamingSubsystem::IsPlayerReady( const APlayerController* Player ) const
+{
+	if ( !bStreamingComplete ) return false;
+
+	// The server's own streaming covers local players
+	const UNetConnection* Connection = Player ? Player->GetNetConnection() : nullptr;
+	if ( !Connection || Player->IsLocalController() ) return true;
+
+	for ( const ULevelStreaming* Level : StreamedLevels )
+	{
+		const ULevel* LoadedLevel = Level ? Level->GetLoadedLevel() : nullptr;
+		if ( LoadedLevel && !Connection->ClientHasInitializedLevel( LoadedLevel ) ) return false;
+	}
+
+	return true;
+}
+
+void UCapstoneLevelStreamingSubsystem::WaitForPlayer( APlayerController* Player )
+{
+	if ( !Player || WaitingPlayers.ContainsByPredicate( [Player]( const FWaitingPlayer& Waiting ) { return Waiting.Player == Player; } ) ) return;
+
+	FWaitingPlayer& Waiting = WaitingPlayers.AddDefaulted_GetRef();
+	Waiting.Player = Player;
+	Waiting.StartTime = GetWorld()->GetTimeSeconds();
+}
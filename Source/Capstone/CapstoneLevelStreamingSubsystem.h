@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CapstoneLevelStreamingSubsystem.generated.h"
+
+class APlayerController;
+class ULevelStreaming;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogCapstoneStreaming, Log, All );
+
+/**
+ * Streams the sublevels of a map in asynchronously once the persistent level is up, instead of loading everything in
+ * one blocking travel. The server decides what is loaded and the engine forwards it to every client; component
+ * registration of each streamed level is time sliced by the s.* settings in DefaultEngine.ini.
+ * New players wait at a ready-check until their client reports every streamed level visible, only then does
+ * ACapstoneGameMode spawn them. Nobody is dropped for streaming slowly.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API UCapstoneLevelStreamingSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void OnWorldBeginPlay( UWorld& InWorld ) override;
+
+	virtual void Tick( float DeltaTime ) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** True once every streamed sublevel is loaded and visible on this machine.*/
+	FORCEINLINE bool IsStreamingComplete() const { return bStreamingComplete; }
+
+	/** True if Player has every streamed sublevel visible, as reported by its client. Server only.*/
+	bool IsPlayerReady( const APlayerController* Player ) const;
+
+	/** Holds Player at the ready-check and starts it through the game mode once it is ready. Server only.*/
+	void WaitForPlayer( APlayerController* Player );
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	/** If false only sublevels already set to load are waited for, the others are left to volumes and gameplay.*/
+	UPROPERTY( config )
+	bool bStreamAllSublevels = true;
+
+	/** Seconds a player may wait at the ready-check before it is logged as slow.*/
+	UPROPERTY( config )
+	float ReadyCheckWarningTime = 30.0f;
+
+	UPROPERTY()
+	TArray<ULevelStreaming*> StreamedLevels;
+
+	struct FWaitingPlayer
+	{
+		TWeakObjectPtr<APlayerController> Player;
+		float StartTime = 0.0f;
+		bool bWarned = false;
+	};
+
+	TArray<FWaitingPlayer> WaitingPlayers;
+
+	bool bStreamingComplete = false;
+
+	double StreamingStartTime = 0.0;
+};
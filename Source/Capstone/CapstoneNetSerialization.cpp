@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneNetSerialization.h"
+
+namespace
+{
+	int32 Quantize( const double Value, const double Precision )
+	{
+		return static_cast<int32>( FMath::Clamp( FMath::RoundToDouble( Value / Precision ), static_cast<double>( MIN_int32 ), static_cast<double>( MAX_int32 ) ) );
+	}
+
+	// Zigzag encoded so small negative steps stay as short as small positive ones
+	void SerializeSignedPacked( FArchive& Ar, int32& Value )
+	{
+		uint32 Encoded = ( static_cast<uint32>( Value ) << 1 ) ^ static_cast<uint32>( Value >> 31 );
+		Ar.SerializeIntPacked( Encoded );
+		if ( Ar.IsLoading() ) Value = static_cast<int32>( Encoded >> 1 ) ^ -static_cast<int32>( Encoded & 1 );
+	}
+
+	bool SerializeChangedBit( FArchive& Ar, const bool bChanged )
+	{
+		uint8 Bit = bChanged ? 1 : 0;
+		Ar.SerializeBits( &Bit, 1 );
+		return Bit != 0;
+	}
+}
+
+void CapstoneNetSerialization::SerializeQuantizedFloat( FArchive& Ar, float& Value, const float Default )
+{
+	const float Precision = GetDefault<UCapstoneNetSerializationSettings>()->FloatPrecision;
+
+	int32 Steps = Ar.IsSaving() ? Quantize( Value - Default, Precision ) : 0;
+	if ( SerializeChangedBit( Ar, Steps != 0 ) ) SerializeSignedPacked( Ar, Steps );
+
+	if ( Ar.IsLoading() ) Value = Default + Steps * Precision;
+}
+
+void CapstoneNetSerialization::SerializeQuantizedVector( FArchive& Ar, FVector& Vector, const FVector& Default, const float Precision )
+{
+	FIntVector Steps = FIntVector::ZeroValue;
+	if ( Ar.IsSaving() )
+	{
+		const FVector Delta = Vector - Default;
+		Steps = FIntVector( Quantize( Delta.X, Precision ), Quantize( Delta.Y, Precision ), Quantize( Delta.Z, Precision ) );
+	}
+
+	if ( SerializeChangedBit( Ar, Steps != FIntVector::ZeroValue ) )
+	{
+		SerializeSignedPacked( Ar, Steps.X );
+		SerializeSignedPacked( Ar, Steps.Y );
+		SerializeSignedPacked( Ar, Steps.Z );
+	}
+
+	if ( Ar.IsLoading() ) Vector = Default + FVector( Steps ) * Precision;
+}
+
+void CapstoneNetSerialization::SerializeQuantizedRotation( FArchive& Ar, FQuat& Rotation, const FQuat& Default )
+{
+	const bool bHighPrecision = GetDefault<UCapstoneNetSerializationSettings>()->bHighPrecisionRotation;
+	const float Tolerance = bHighPrecision ? 360.0f / 65536.0f : 360.0f / 256.0f;
+
+	// Rotation is Default followed by Delta
+	FRotator Delta = FRotator::ZeroRotator;
+	if ( Ar.IsSaving() ) Delta = ( Default.Inverse() * Rotation ).Rotator();
+
+	if ( SerializeChangedBit( Ar, !Delta.IsNearlyZero( Tolerance * 0.5f ) ) )
+	{
+		if ( bHighPrecision ) Delta.SerializeCompressedShort( Ar );
+		else Delta.SerializeCompressed( Ar );
+
+		if ( Ar.IsLoading() ) Rotation = Default * Delta.Quaternion();
+	}
+	else if ( Ar.IsLoading() )
+	{
+		Rotation = Default;
+	}
+}
+
+void CapstoneNetSerialization::SerializeQuantizedTransform( FArchive& Ar, FTransform& Transform, const FTransform& Default )
+{
+	const UCapstoneNetSerializationSettings* Settings = GetDefault<UCapstoneNetSerializationSettings>();
+
+	FVector Translation = Transform.GetTranslation();
+	FQuat Rotation = Transform.GetRotation();
+	FVector Scale = Transform.GetScale3D();
+
+	SerializeQuantizedVector( Ar, Translation, Default.GetTranslation(), Settings->PositionPrecision );
+	SerializeQuantizedRotation( Ar, Rotation, Default.GetRotation() );
+	SerializeQuantizedVector( Ar, Scale, Default.GetScale3D(), Settings->ScalePrecision );
+
+	if ( Ar.IsLoading() ) Transform = FTransform( Rotation, Translation, Scale );
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "CapstoneNetSerialization.generated.h"
+
+/**
+ * Precision of the quantized transforms sent by FWeaponCustomization. Both ends of a connection must
+ * use the same values, so they live in DefaultGame.ini and are not meant to be changed at runtime.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API UCapstoneNetSerializationSettings : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Smallest position step in centimeters.*/
+	UPROPERTY( config )
+	float PositionPrecision = 0.01f;
+
+	/** Smallest scale step.*/
+	UPROPERTY( config )
+	float ScalePrecision = 0.001f;
+
+	/** Smallest step of other floats such as the aim offset.*/
+	UPROPERTY( config )
+	float FloatPrecision = 0.01f;
+
+	/** Rotations use 16 bits per axis if true, 8 otherwise.*/
+	UPROPERTY( config )
+	bool bHighPrecisionRotation = true;
+};
+
+/**
+ * Quantized delta serialization. Every value is sent as its difference to a default both ends know, e.g. the class
+ * default of a weapon, so a value that matches its default costs a single bit.
+ */
+namespace CapstoneNetSerialization
+{
+	CAPSTONE_API void SerializeQuantizedFloat( FArchive& Ar, float& Value, const float Default );
+	CAPSTONE_API void SerializeQuantizedVector( FArchive& Ar, FVector& Vector, const FVector& Default, const float Precision );
+	CAPSTONE_API void SerializeQuantizedRotation( FArchive& Ar, FQuat& Rotation, const FQuat& Default );
+	CAPSTONE_API void SerializeQuantizedTransform( FArchive& Ar, FTransform& Transform, const FTransform& Default );
+}
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+// Replication cost of gameplay state, graph with "stat CapstoneNet"
+DECLARE_STATS_GROUP( TEXT( "CapstoneNet" ), STATGROUP_CapstoneNet, STATCAT_Advanced );
+
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Loadout Delta Serialize" ), STAT_LoadoutDeltaSerialize, STATGROUP_CapstoneNet, CAPSTONE_API );
+DECLARE_DWORD_COUNTER_STAT_EXTERN( TEXT( "Loadout Bytes Sent" ), STAT_LoadoutBytesSent, STATGROUP_CapstoneNet, CAPSTONE_API );
+DECLARE_DWORD_COUNTER_STAT_EXTERN( TEXT( "Character Dirty Marks" ), STAT_CharacterDirtyMarks, STATGROUP_CapstoneNet, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Replicate Actors" ), STAT_ReplicateActors, STATGROUP_CapstoneNet, CAPSTONE_API );
+
+// Per-character replication time and bytes, one column per character, record with "csvprofile start"
+CSV_DECLARE_CATEGORY_EXTERN( CapstoneNet );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Damage Hits Queued" ), STAT_DamageHitsQueued, STATGROUP_CapstoneNet, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Damage Events Sent" ), STAT_DamageEventsSent, STATGROUP_CapstoneNet, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Hit-Scan Impacts Sent" ), STAT_HitScanImpactsSent, STATGROUP_CapstoneNet, CAPSTONE_API );
+
+// Set once per UNetSchedulerSubsystem update, so they are accumulators that hold their value between updates
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Net Scheduler Update" ), STAT_NetSchedulerUpdate, STATGROUP_CapstoneNet, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Net Scheduled Actors" ), STAT_NetScheduledActors, STATGROUP_CapstoneNet, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Dormant Weapons" ), STAT_DormantWeapons, STATGROUP_CapstoneNet, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Weapon Channels" ), STAT_WeaponChannels, STATGROUP_CapstoneNet, CAPSTONE_API );
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstonePlayerState.h"
+
+#include "Engine/AssetManager.h"
+
+void ACapstonePlayerState::SaveLoadout( const FSavedLoadout& Loadout )
+{
+	SavedLoadout = Loadout;
+	bHasSavedLoadout = true;
+
+	// The classes are loaded already, the handle only stops them from being collected during the travel
+	TArray<FSoftObjectPath> WeaponClasses;
+	for ( const FSavedWeapon& Weapon : SavedLoadout.Weapons )
+	{
+		if ( !Weapon.WeaponClass.IsNull() ) WeaponClasses.AddUnique( Weapon.WeaponClass.ToSoftObjectPath() );
+	}
+
+	WeaponClassHandle = WeaponClasses.Num() > 0 ? UAssetManager::GetStreamableManager().RequestAsyncLoad( WeaponClasses ) : nullptr;
+}
+
+bool ACapstonePlayerState::ConsumeSavedLoadout( FSavedLoadout& OutLoadout )
+{
+	if ( !bHasSavedLoadout ) return false;
+
+	OutLoadout = MoveTemp( SavedLoadout );
+	SavedLoadout = FSavedLoadout();
+	bHasSavedLoadout = false;
+	WeaponClassHandle.Reset();
+	return true;
+}
+
+void ACapstonePlayerState::SetTravellingCharacter( ACapstoneCharacter* Character )
+{
+	TravellingCharacter = Character;
+}
+
+ACapstoneCharacter* ACapstonePlayerState::ConsumeTravellingCharacter()
+{
+	ACapstoneCharacter* Character = TravellingCharacter;
+	TravellingCharacter = nullptr;
+	return Character;
+}
+
+void ACapstonePlayerState::CopyProperties( APlayerState* PlayerState )
+{
+	Super::CopyProperties( PlayerState );
+
+	if ( ACapstonePlayerState* CapstonePlayerState = Cast<ACapstonePlayerState>( PlayerState ) )
+	{
+		CapstonePlayerState->SavedLoadout = SavedLoadout;
+		CapstonePlayerState->bHasSavedLoadout = bHasSavedLoadout;
+		CapstonePlayerState->WeaponClassHandle = WeaponClassHandle;
+		CapstonePlayerState->TravellingCharacter = TravellingCharacter;
+	}
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/StreamableManager.h"
+#include "Weapon.h"
+#include "CapstonePlayerState.generated.h"
+
+class ACapstoneCharacter;
+
+// One spawned weapon of a saved loadout
+USTRUCT()
+struct FSavedWeapon
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 Slot = 0;
+
+	UPROPERTY()
+	TSoftClassPtr<AWeapon> WeaponClass;
+
+	UPROPERTY()
+	FWeaponCustomization Customization;
+};
+
+// A character's loadout as it was when the server travelled
+USTRUCT()
+struct FSavedLoadout
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 CurrentIndex = 0;
+
+	UPROPERTY()
+	TArray<FSavedWeapon> Weapons;
+};
+
+/**
+ * Carries a player's loadout across seamless travel. Player states survive the travel, or are copied into the new
+ * map's player state class, so the loadout saved on the way out is handed to the first character the player
+ * possesses on the other side. The character itself travels too, pooled and with its weapons still attached, and is
+ * given back to the same player when it is restarted. The weapon classes are kept resident in between so nothing is
+ * loaded twice.
+ */
+UCLASS()
+class CAPSTONE_API ACapstonePlayerState : public APlayerState
+{
+	GENERATED_BODY()
+
+public:
+	/** Keeps Loadout for the next map. Server only.*/
+	void SaveLoadout( const FSavedLoadout& Loadout );
+
+	/** Hands the saved loadout over once. Returns false if nothing was saved since the last call.*/
+	bool ConsumeSavedLoadout( FSavedLoadout& OutLoadout );
+
+	/** Keeps the pooled Character for the next map. Server only.*/
+	void SetTravellingCharacter( ACapstoneCharacter* Character );
+
+	FORCEINLINE ACapstoneCharacter* GetTravellingCharacter() const { return TravellingCharacter; }
+
+	/** Hands the travelling character over once, nullptr if there is none.*/
+	ACapstoneCharacter* ConsumeTravellingCharacter();
+
+protected:
+	virtual void CopyProperties( APlayerState* PlayerState ) override;
+
+	UPROPERTY()
+	FSavedLoadout SavedLoadout;
+
+	bool bHasSavedLoadout = false;
+
+	// The character the player left the last map with, until the new map's pool takes it
+	UPROPERTY()
+	ACapstoneCharacter* TravellingCharacter = nullptr;
+
+	// Keeps the saved weapon classes loaded through the travel
+	TSharedPtr<FStreamableHandle> WeaponClassHandle;
+};
@@ -0,0 +1,242 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneReplicationGraph.h"
+#include "CapstoneCharacter.h"
+#include "Weapon.h"
+#include "NetworkProjectile.h"
+#include "ProjectileBatchManager.h"
+#include "DamageBatchManager.h"
+#include "CapstoneNetStats.h"
+
+#include "Engine/LevelScriptActor.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_LOG_CATEGORY( LogCapstoneRepGraph );
+
+void UCapstoneReplicationGraphNode_ForConnection::GatherActorListsForConnection( const FConnectionGatherActorListParameters& Params )
+{
+	ReplicationActorList.Reset();
+
+	for ( const FNetViewer& Viewer : Params.Viewers )
+	{
+		if ( Viewer.InViewer ) ReplicationActorList.ConditionalAdd( Viewer.InViewer );
+		if ( Viewer.ViewTarget ) ReplicationActorList.ConditionalAdd( Viewer.ViewTarget );
+
+		// The possessed pawn is spatialized as well, but must never be culled for its own connection
+		if ( const APlayerController* PlayerController = Cast<APlayerController>( Viewer.InViewer ) )
+		{
+			if ( APawn* Pawn = PlayerController->GetPawn() ) ReplicationActorList.ConditionalAdd( Pawn );
+		}
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList( ReplicationActorList );
+}
+
+void UCapstoneReplicationGraphNode_OwnerOnly::NotifyAddNetworkActor( const FNewReplicatedActorInfo& ActorInfo )
+{
+	OwnerOnlyActors.Add( ActorInfo.Actor );
+}
+
+bool UCapstoneReplicationGraphNode_OwnerOnly::NotifyRemoveNetworkActor( const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound )
+{
+	const bool bRemoved = OwnerOnlyActors.RemoveFast( ActorInfo.Actor );
+	if ( !bRemoved && bWarnIfNotFound ) UE_LOG( LogCapstoneRepGraph, Warning, TEXT( "Owner-only actor %s was not in the graph" ), *GetNameSafe( ActorInfo.Actor ) );
+
+	return bRemoved;
+}
+
+void UCapstoneReplicationGraphNode_OwnerOnly::NotifyResetAllNetworkActors()
+{
+	OwnerOnlyActors.Reset();
+	ConnectionActorList.Reset();
+}
+
+void UCapstoneReplicationGraphNode_OwnerOnly::GatherActorListsForConnection( const FConnectionGatherActorListParameters& Params )
+{
+	ConnectionActorList.Reset();
+
+	for ( AActor* Actor : OwnerOnlyActors )
+	{
+		// Owners can change after the actor was added, so the connection is looked up every gather
+		const UNetConnection* OwningConnection = Actor ? Actor->GetNetConnection() : nullptr;
+		if ( !OwningConnection ) continue;
+
+		for ( const FNetViewer& Viewer : Params.Viewers )
+		{
+			if ( Viewer.Connection != OwningConnection ) continue;
+
+			ConnectionActorList.Add( Actor );
+			break;
+		}
+	}
+
+	if ( ConnectionActorList.Num() > 0 ) Params.OutGatheredReplicationLists.AddReplicationActorList( ConnectionActorList );
+}
+
+ECapstoneRepNodeMapping UCapstoneReplicationGraph::GetMappingPolicy( const UClass* Class )
+{
+	if ( const ECapstoneRepNodeMapping* Policy = ClassRepNodePolicies.Get( Class ) ) return *Policy;
+
+	// Classes nobody mapped explicitly are routed by their replication settings
+	const AActor* Defaults = Class->GetDefaultObject<AActor>();
+	ECapstoneRepNodeMapping Policy = ECapstoneRepNodeMapping::Spatialize_Dynamic;
+	if ( Defaults->bAlwaysRelevant ) Policy = ECapstoneRepNodeMapping::AlwaysRelevant;
+	else if ( Defaults->bOnlyRelevantToOwner ) Policy = ECapstoneRepNodeMapping::RelevantToOwner;
+	else if ( !Defaults->IsReplicatingMovement() ) Policy = ECapstoneRepNodeMapping::Spatialize_Dormancy;
+
+	ClassRepNodePolicies.Set( Class, Policy );
+	return Policy;
+}
+
+void UCapstoneReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	ClassRepNodePolicies.Set( AGameStateBase::StaticClass(), ECapstoneRepNodeMapping::AlwaysRelevant );
+	ClassRepNodePolicies.Set( APlayerState::StaticClass(), ECapstoneRepNodeMapping::AlwaysRelevant );
+	ClassRepNodePolicies.Set( ALevelScriptActor::StaticClass(), ECapstoneRepNodeMapping::NotRouted );
+	ClassRepNodePolicies.Set( APlayerController::StaticClass(), ECapstoneRepNodeMapping::RelevantToOwner );
+	ClassRepNodePolicies.Set( AProjectileBatchManager::StaticClass(), ECapstoneRepNodeMapping::AlwaysRelevant );
+	ClassRepNodePolicies.Set( ADamageBatchManager::StaticClass(), ECapstoneRepNodeMapping::AlwaysRelevant );
+	ClassRepNodePolicies.Set( ACapstoneCharacter::StaticClass(), ECapstoneRepNodeMapping::Spatialize_Dynamic );
+	ClassRepNodePolicies.Set( ANetworkProjectile::StaticClass(), ECapstoneRepNodeMapping::Spatialize_Dynamic );
+	ClassRepNodePolicies.Set( AWeapon::StaticClass(), ECapstoneRepNodeMapping::NotRouted );
+
+	// Give every replicated class its replication period and cull distance up front
+	for ( TObjectIterator<UClass> It; It; ++It )
+	{
+		UClass* Class = *It;
+		if ( !Class->IsChildOf( AActor::StaticClass() ) || Class->HasAnyClassFlags( CLASS_Abstract | CLASS_Deprecated | CLASS_NewerVersionExists ) ) continue;
+
+		const AActor* Defaults = Class->GetDefaultObject<AActor>();
+		if ( !Defaults->GetIsReplicated() ) continue;
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency( Defaults->NetUpdateFrequency );
+		ClassInfo.SetCullDistanceSquared( Defaults->NetCullDistanceSquared );
+		GlobalActorReplicationInfoMap.SetClassInfo( Class, ClassInfo );
+
+		GetMappingPolicy( Class );
+	}
+
+	DestructInfoMaxDistanceSquared = FMath::Square( DestructionInfoMaxDistance );
+}
+
+void UCapstoneReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = SpatialBias;
+	AddGlobalGraphNode( GridNode );
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode( AlwaysRelevantNode );
+
+	OwnerOnlyNode = CreateNewNode<UCapstoneReplicationGraphNode_OwnerOnly>();
+	AddGlobalGraphNode( OwnerOnlyNode );
+}
+
+void UCapstoneReplicationGraph::InitConnectionGraphNodes( UNetReplicationGraphConnection* RepGraphConnection )
+{
+	Super::InitConnectionGraphNodes( RepGraphConnection );
+
+	UCapstoneReplicationGraphNode_ForConnection* ConnectionNode = CreateNewNode<UCapstoneReplicationGraphNode_ForConnection>();
+	AddConnectionGraphNode( ConnectionNode, RepGraphConnection );
+}
+
+void UCapstoneReplicationGraph::RouteAddNetworkActorToNodes( const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo )
+{
+	ECapstoneRepNodeMapping Policy = GetMappingPolicy( ActorInfo.Class );
+
+	// Weapons replicate whenever their owning character does, an unowned weapon is spatialized like anything else
+	if ( AWeapon* Weapon = Cast<AWeapon>( ActorInfo.Actor ) )
+	{
+		if ( ACapstoneCharacter* Owner = Cast<ACapstoneCharacter>( Weapon->GetOwner() ) )
+		{
+			GlobalActorReplicationInfoMap.AddDependentActor( Owner, Weapon );
+			WeaponDependencyOwners.Add( Weapon, Owner );
+			return;
+		}
+
+		Policy = ECapstoneRepNodeMapping::Spatialize_Dynamic;
+	}
+
+	switch ( Policy )
+	{
+	case ECapstoneRepNodeMapping::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyAddNetworkActor( ActorInfo );
+		break;
+	case ECapstoneRepNodeMapping::RelevantToOwner:
+		OwnerOnlyNode->NotifyAddNetworkActor( ActorInfo );
+		break;
+	case ECapstoneRepNodeMapping::Spatialize_Static:
+		GridNode->AddActor_Static( ActorInfo, GlobalInfo );
+		break;
+	case ECapstoneRepNodeMapping::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic( ActorInfo, GlobalInfo );
+		break;
+	case ECapstoneRepNodeMapping::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy( ActorInfo, GlobalInfo );
+		break;
+	default:
+		break;
+	}
+}
+
+void UCapstoneReplicationGraph::RouteRemoveNetworkActorToNodes( const FNewReplicatedActorInfo& ActorInfo )
+{
+	ECapstoneRepNodeMapping Policy = GetMappingPolicy( ActorInfo.Class );
+
+	if ( AWeapon* Weapon = Cast<AWeapon>( ActorInfo.Actor ) )
+	{
+		// Removed from whatever it was added to, not from its current owner
+		TWeakObjectPtr<AActor> Owner;
+		if ( WeaponDependencyOwners.RemoveAndCopyValue( Weapon, Owner ) )
+		{
+			if ( AActor* OwnerActor = Owner.Get() ) GlobalActorReplicationInfoMap.RemoveDependentActor( OwnerActor, Weapon );
+			return;
+		}
+
+		Policy = ECapstoneRepNodeMapping::Spatialize_Dynamic;
+	}
+
+	switch ( Policy )
+	{
+	case ECapstoneRepNodeMapping::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor( ActorInfo );
+		break;
+	case ECapstoneRepNodeMapping::RelevantToOwner:
+		OwnerOnlyNode->NotifyRemoveNetworkActor( ActorInfo );
+		break;
+	case ECapstoneRepNodeMapping::Spatialize_Static:
+		GridNode->RemoveActor_Static( ActorInfo );
+		break;
+	case ECapstoneRepNodeMapping::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic( ActorInfo );
+		break;
+	case ECapstoneRepNodeMapping::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy( ActorInfo );
+		break;
+	default:
+		break;
+	}
+}
+
+int32 UCapstoneReplicationGraph::ServerReplicateActors( float DeltaSeconds )
+{
+	SCOPE_CYCLE_COUNTER( STAT_ReplicateActors );
+
+	return Super::ServerReplicateActors( DeltaSeconds );
+}
+
+void UCapstoneReplicationGraph::SetActorUpdateRate( AActor* Actor, const float NetUpdateFrequency, const float NetPriority )
+{
+	FGlobalActorReplicationInfo* GlobalInfo = GlobalActorReplicationInfoMap.Find( Actor );
+	if ( !GlobalInfo ) return;
+
+	GlobalInfo->Settings.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency( NetUpdateFrequency );
+	GlobalInfo->Settings.AccumulatedNetPriorityBias = ( 1.0f - NetPriority ) * NetPriorityBiasScale;
+}
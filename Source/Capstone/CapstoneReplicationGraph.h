@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "CapstoneReplicationGraph.generated.h"
+
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogCapstoneRepGraph, Log, All );
+
+// How actors of a class are routed into the graph
+UENUM()
+enum class ECapstoneRepNodeMapping : uint8
+{
+	NotRouted,				// Handled by another actor, e.g. weapons replicate with their owning character
+	RelevantToOwner,		// Only the owning connection needs it, e.g. player controllers
+	AlwaysRelevant,			// Game state, player states, chat and other global actors
+	Spatialize_Static,		// Spatialized, never moves
+	Spatialize_Dynamic,		// Spatialized, moves and is re-binned every frame
+	Spatialize_Dormancy,	// Spatialized, treated as static while dormant
+};
+
+// Per connection node that always replicates the connection's own controller and view target
+UCLASS()
+class UCapstoneReplicationGraphNode_ForConnection : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NotifyAddNetworkActor( const FNewReplicatedActorInfo& ActorInfo ) override {}
+	virtual bool NotifyRemoveNetworkActor( const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true ) override { return false; }
+	virtual void NotifyResetAllNetworkActors() override { ReplicationActorList.Reset(); }
+	virtual void GatherActorListsForConnection( const FConnectionGatherActorListParameters& Params ) override;
+
+private:
+	FActorRepListRefView ReplicationActorList;
+};
+
+// Global node for actors only their owner's connection may see. There are only a few per player, so each
+// connection filters the whole list on gather instead of the graph tracking owners as they change
+UCLASS()
+class UCapstoneReplicationGraphNode_OwnerOnly : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	virtual void NotifyAddNetworkActor( const FNewReplicatedActorInfo& ActorInfo ) override;
+	virtual bool NotifyRemoveNetworkActor( const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true ) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void GatherActorListsForConnection( const FConnectionGatherActorListParameters& Params ) override;
+
+private:
+	FActorRepListRefView OwnerOnlyActors;
+
+	// Rebuilt for each connection as it is gathered, connections are replicated one after the other
+	FActorRepListRefView ConnectionActorList;
+};
+
+/**
+ * Replication graph for the project. Characters, weapons and projectiles are binned into a 2D spatial grid so a
+ * connection only considers actors in nearby cells, global actors go into a single always relevant list, and
+ * weapons owned by an ACapstoneCharacter are dependents of their owner instead of being considered on their own.
+ * Enabled through ReplicationDriverClassName in DefaultEngine.ini.
+ */
+UCLASS( transient, config = Engine )
+class UCapstoneReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes( UNetReplicationGraphConnection* RepGraphConnection ) override;
+	virtual void RouteAddNetworkActorToNodes( const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo ) override;
+	virtual void RouteRemoveNetworkActorToNodes( const FNewReplicatedActorInfo& ActorInfo ) override;
+
+	/** Times the whole replication pass, property comparison and delta serialization of every actor included.*/
+	virtual int32 ServerReplicateActors( float DeltaSeconds ) override;
+
+	/** Overrides the replication period and priority Actor got from its class, see UNetSchedulerSubsystem.*/
+	void SetActorUpdateRate( AActor* Actor, const float NetUpdateFrequency, const float NetPriority );
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	UPROPERTY()
+	UCapstoneReplicationGraphNode_OwnerOnly* OwnerOnlyNode;
+
+protected:
+	ECapstoneRepNodeMapping GetMappingPolicy( const UClass* Class );
+
+	/** Size of one grid cell in world units.*/
+	UPROPERTY( config )
+	float GridCellSize = 10000.0f;
+
+	/** Lowest world coordinate the grid covers, actors below it are clamped into the first cell.*/
+	UPROPERTY( config )
+	FVector2D SpatialBias = FVector2D( -150000.0f, -150000.0f );
+
+	/** Actors closer than this to a connection when they are destroyed send it their destruction info.*/
+	UPROPERTY( config )
+	float DestructionInfoMaxDistance = 30000.0f;
+
+	/** Priority bias per point of NetPriority above 1. The graph sends the lowest accumulated priority first.*/
+	UPROPERTY( config )
+	float NetPriorityBiasScale = 0.5f;
+
+	TClassMap<ECapstoneRepNodeMapping> ClassRepNodePolicies;
+
+	// Character each weapon was made a dependent of, the weapon's owner may have changed by the time it is removed
+	TMap<TObjectKey<AActor>, TWeakObjectPtr<AActor>> WeaponDependencyOwners;
+};
@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneSignificanceManager.h"
+#include "CapstoneCharacter.h"
+#include "FluidAnimInstance.h"
+
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+static const FName CharacterSignificanceTag( "Character" );
+
+void UCapstoneSignificanceManager::RegisterCharacter( ACharacter* Character )
+{
+	if ( !Character ) return;
+
+	UCapstoneSignificanceManager* Manager = USignificanceManager::Get<UCapstoneSignificanceManager>( Character->GetWorld() );
+	if ( !Manager ) return;
+
+	Character->GetMesh()->bEnableUpdateRateOptimizations = true;
+
+	Manager->RegisterObject( Character, CharacterSignificanceTag,
+		[Manager]( FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint ) { return Manager->CalculateSignificance( ObjectInfo, Viewpoint ); },
+		EPostSignificanceType::None );
+}
+
+void UCapstoneSignificanceManager::UnregisterCharacter( ACharacter* Character )
+{
+	if ( !Character ) return;
+
+	if ( UCapstoneSignificanceManager* Manager = USignificanceManager::Get<UCapstoneSignificanceManager>( Character->GetWorld() ) )
+	{
+		Manager->UnregisterObject( Character );
+		Manager->CurrentTiers.Remove( Character );
+	}
+}
+
+ETickableTickType UCapstoneSignificanceManager::GetTickableTickType() const
+{
+	return HasAnyFlags( RF_ClassDefaultObject ) ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+bool UCapstoneSignificanceManager::IsTickable() const
+{
+	return GetWorld() && GetWorld()->IsGameWorld();
+}
+
+TStatId UCapstoneSignificanceManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT( UCapstoneSignificanceManager, STATGROUP_Tickables );
+}
+
+void UCapstoneSignificanceManager::Tick( float DeltaTime )
+{
+	Viewpoints.Reset();
+	for ( FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It )
+	{
+		const APlayerController* PlayerController = It->Get();
+		if ( !PlayerController || !PlayerController->IsLocalController() ) continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint( ViewLocation, ViewRotation );
+		Viewpoints.Emplace( ViewRotation, ViewLocation );
+	}
+
+	RecordAnimCost( FFluidAnimInstanceProxy::ConsumeUpdateCost() );
+
+	if ( Viewpoints.Num() == 0 ) return;
+
+	Update( Viewpoints );
+	ApplyBudget();
+}
+
+float UCapstoneSignificanceManager::CalculateSignificance( FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint ) const
+{
+	const ACharacter* Character = Cast<ACharacter>( ObjectInfo->GetObject() );
+	if ( !Character ) return 0.0f;
+
+	// Approximate screen size by the capsule's height over its distance to the view
+	const FVector ToCharacter = Character->GetActorLocation() - Viewpoint.GetLocation();
+	const float Distance = FMath::Max( ToCharacter.Size(), 1.0f );
+	float Significance = Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() / Distance;
+
+	// Characters behind the camera or not rendered lately matter far less than ones on screen
+	if ( ( ToCharacter | Viewpoint.GetRotation().GetForwardVector() ) < 0.0f ) Significance *= 0.25f;
+	if ( !Character->GetMesh()->WasRecentlyRendered( 0.2f ) ) Significance *= 0.1f;
+
+	if ( const ACapstoneCharacter* CapstoneCharacter = Cast<ACapstoneCharacter>( Character ) )
+	{
+		if ( CapstoneCharacter->IsInCombat( CombatWindow ) ) Significance *= CombatMultiplier;
+	}
+
+	return Significance;
+}
+
+void UCapstoneSignificanceManager::RecordAnimCost( const FFluidAnimUpdateCost& Cost )
+{
+	MeasuredAnimMs = Cost.IKMs + Cost.BaseMs;
+
+	if ( Cost.IKUpdates > 0 )
+	{
+		const float Sample = Cost.IKMs / Cost.IKUpdates;
+		MeasuredIKUpdateMs = MeasuredIKUpdateMs < 0.0f ? Sample : FMath::Lerp( MeasuredIKUpdateMs, Sample, CostSmoothing );
+	}
+
+	if ( Cost.BaseUpdates > 0 )
+	{
+		const float Sample = Cost.BaseMs / Cost.BaseUpdates;
+		MeasuredBaseUpdateMs = MeasuredBaseUpdateMs < 0.0f ? Sample : FMath::Lerp( MeasuredBaseUpdateMs, Sample, CostSmoothing );
+	}
+}
+
+float UCapstoneSignificanceManager::GetTierCost( const ECharacterAnimTier Tier ) const
+{
+	const float IKUpdateMs = MeasuredIKUpdateMs >= 0.0f ? MeasuredIKUpdateMs : FullTierCostMs;
+	const float BaseUpdateMs = MeasuredBaseUpdateMs >= 0.0f ? MeasuredBaseUpdateMs : IKUpdateMs;
+
+	// Cost scales with how often the mesh updates relative to a 60 Hz frame
+	switch ( Tier )
+	{
+	case ECharacterAnimTier::Full:
+		return IKUpdateMs;
+	case ECharacterAnimTier::Reduced:
+		return BaseUpdateMs * FMath::Min( 1.0f, 1.0f / ( ReducedTickInterval * 60.0f ) );
+	case ECharacterAnimTier::Minimal:
+		return BaseUpdateMs * FMath::Min( 1.0f, 1.0f / ( MinimalTickInterval * 60.0f ) );
+	default:
+		return 0.0f;
+	}
+}
+
+ECharacterAnimTier UCapstoneSignificanceManager::FitToBudget( ECharacterAnimTier Tier, const float SpentMs ) const
+{
+	while ( Tier != ECharacterAnimTier::Paused && SpentMs + GetTierCost( Tier ) > AnimBudgetMs )
+	{
+		Tier = static_cast<ECharacterAnimTier>( static_cast<uint8>( Tier ) + 1 );
+	}
+	return Tier;
+}
+
+void UCapstoneSignificanceManager::ApplyBudget()
+{
+	GetManagedObjects( CharacterSignificanceTag, SortedObjects, true );
+
+	BudgetSpentMs = 0.0f;
+	for ( const FManagedObjectInfo* ObjectInfo : SortedObjects )
+	{
+		ACharacter* Character = Cast<ACharacter>( ObjectInfo->GetObject() );
+		if ( !Character ) continue;
+
+		const float Significance = ObjectInfo->GetSignificance();
+
+		// The local player's own pawn is never budgeted down
+		ECharacterAnimTier Tier = ECharacterAnimTier::Minimal;
+		if ( Character->IsLocallyControlled() || Significance >= FullSignificance ) Tier = ECharacterAnimTier::Full;
+		else if ( Significance >= ReducedSignificance ) Tier = ECharacterAnimTier::Reduced;
+
+		if ( !Character->IsLocallyControlled() ) Tier = FitToBudget( Tier, BudgetSpentMs );
+
+		BudgetSpentMs += GetTierCost( Tier );
+		ApplyTier( Character, Tier );
+	}
+}
+
+void UCapstoneSignificanceManager::ApplyTier( ACharacter* Character, const ECharacterAnimTier Tier )
+{
+	ECharacterAnimTier& CurrentTier = CurrentTiers.FindOrAdd( Character, ECharacterAnimTier::Full );
+	if ( CurrentTier == Tier && Character->GetMesh()->IsComponentTickEnabled() == ( Tier != ECharacterAnimTier::Paused ) ) return;
+	CurrentTier = Tier;
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	switch ( Tier )
+	{
+	case ECharacterAnimTier::Full:
+		Mesh->SetComponentTickEnabled( true );
+		Mesh->SetComponentTickInterval( 0.0f );
+		Mesh->bEnableUpdateRateOptimizations = false;
+		break;
+	case ECharacterAnimTier::Reduced:
+		Mesh->SetComponentTickEnabled( true );
+		Mesh->SetComponentTickInterval( ReducedTickInterval );
+		Mesh->bEnableUpdateRateOptimizations = true;
+		break;
+	case ECharacterAnimTier::Minimal:
+		Mesh->SetComponentTickEnabled( true );
+		Mesh->SetComponentTickInterval( MinimalTickInterval );
+		Mesh->bEnableUpdateRateOptimizations = true;
+		break;
+	case ECharacterAnimTier::Paused:
+		Mesh->SetComponentTickEnabled( false );
+		break;
+	}
+
+	if ( UFluidAnimInstance* AnimInstance = Cast<UFluidAnimInstance>( Mesh->GetAnimInstance() ) )
+	{
+		AnimInstance->bIKAllowedBySignificance = Tier == ECharacterAnimTier::Full;
+	}
+}
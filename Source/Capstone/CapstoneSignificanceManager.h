@@ -0,0 +1,117 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SignificanceManager.h"
+#include "Tickable.h"
+#include "FluidAnimInstance.h"
+#include "CapstoneSignificanceManager.generated.h"
+
+class ACharacter;
+
+// How much animation work a character gets this frame, from most to least
+UENUM()
+enum class ECharacterAnimTier : uint8
+{
+	Full,		// Every frame, IK on
+	Reduced,	// Ticks at ReducedTickInterval with update rate optimizations, IK off
+	Minimal,	// Ticks at MinimalTickInterval with update rate optimizations, IK off
+	Paused,		// Animation does not tick at all
+};
+
+/**
+ * Scores every registered character by distance, screen size and whether it is in combat, then hands out animation
+ * update tiers from the most to the least significant character until the per-frame animation budget is spent.
+ * Tier costs come from the proxy update times UFluidAnimInstance measures, the config estimate is only a starting point.
+ * Client only; set as SignificanceManagerClassName in DefaultEngine.ini.
+ */
+UCLASS( config = Engine )
+class CAPSTONE_API UCapstoneSignificanceManager : public USignificanceManager, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Starts budgeting the animation of Character. Works for players and enemies alike.*/
+	UFUNCTION( BlueprintCallable, Category = "Significance" )
+	static void RegisterCharacter( ACharacter* Character );
+
+	UFUNCTION( BlueprintCallable, Category = "Significance" )
+	static void UnregisterCharacter( ACharacter* Character );
+
+	// FTickableGameObject
+	virtual void Tick( float DeltaTime ) override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+	FORCEINLINE float GetBudgetSpentMs() const { return BudgetSpentMs; }
+
+	/** Animation time actually measured last frame, across all characters.*/
+	FORCEINLINE float GetMeasuredAnimMs() const { return MeasuredAnimMs; }
+
+protected:
+	friend class FCapstoneSignificanceBudgetTest;
+
+	/** Folds one frame of measured update times into the per-update costs the budget is planned with.*/
+	void RecordAnimCost( const FFluidAnimUpdateCost& Cost );
+
+	/** Lowers Tier until it fits into what is left of the budget after SpentMs.*/
+	ECharacterAnimTier FitToBudget( ECharacterAnimTier Tier, const float SpentMs ) const;
+
+	float CalculateSignificance( FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint ) const;
+
+	/** Walks the characters in significance order and assigns each the best tier that still fits the budget.*/
+	void ApplyBudget();
+	void ApplyTier( ACharacter* Character, const ECharacterAnimTier Tier );
+
+	float GetTierCost( const ECharacterAnimTier Tier ) const;
+
+	/** Animation milliseconds per frame all budgeted characters may use together.*/
+	UPROPERTY( config )
+	float AnimBudgetMs = 2.0f;
+
+	/** Estimated cost of one character animating every frame with IK, used until updates have been measured.*/
+	UPROPERTY( config )
+	float FullTierCostMs = 0.1f;
+
+	/** How much of each frame's measurement goes into the running per-update costs, smooths out single slow frames.*/
+	UPROPERTY( config )
+	float CostSmoothing = 0.1f;
+
+	UPROPERTY( config )
+	float ReducedTickInterval = 1.0f / 30.0f;
+
+	UPROPERTY( config )
+	float MinimalTickInterval = 1.0f / 10.0f;
+
+	/** Significance at or above which a character may animate at the full tier.*/
+	UPROPERTY( config )
+	float FullSignificance = 0.05f;
+
+	/** Significance at or above which a character may animate at the reduced tier.*/
+	UPROPERTY( config )
+	float ReducedSignificance = 0.01f;
+
+	/** Multiplier applied to characters that are in combat.*/
+	UPROPERTY( config )
+	float CombatMultiplier = 2.0f;
+
+	/** Seconds after its last shot a character still counts as in combat.*/
+	UPROPERTY( config )
+	float CombatWindow = 3.0f;
+
+	TMap<TObjectKey<ACharacter>, ECharacterAnimTier> CurrentTiers;
+
+	TArray<FTransform> Viewpoints;
+	TArray<const FManagedObjectInfo*> SortedObjects;
+
+	float BudgetSpentMs = 0.0f;
+
+	// Measured cost of one proxy update with and without IK, negative until the first measurement
+	float MeasuredIKUpdateMs = -1.0f;
+	float MeasuredBaseUpdateMs = -1.0f;
+
+	float MeasuredAnimMs = 0.0f;
+};
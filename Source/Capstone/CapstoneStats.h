@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+// Gameplay cost counters, graph with "stat Capstone"
+DECLARE_STATS_GROUP( TEXT( "Capstone" ), STATGROUP_Capstone, STATCAT_Advanced );
+
+// Insights channel of the gameplay scopes, record with -trace=cpu,counters,capstone. Unlike stats it exists in Test builds.
+UE_TRACE_CHANNEL_EXTERN( CapstoneChannel, CAPSTONE_API );
+
+// Times a block of gameplay code both in "stat Capstone" and on the Capstone trace channel
+#define CAPSTONE_SCOPE_CYCLE_COUNTER( Stat ) \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL( Stat, CapstoneChannel ); \
+	SCOPE_CYCLE_COUNTER( Stat )
+
+// Marks the start of a server RPC implementation: times it and counts it towards the RPCs per second
+#define CAPSTONE_SERVER_RPC( Stat ) \
+	CAPSTONE_SCOPE_CYCLE_COUNTER( Stat ); \
+	CapstoneStats::RecordServerRPC()
+
+namespace CapstoneStats
+{
+	/** Counts a server RPC received. The RPCs per second are published once a second by the module.*/
+	CAPSTONE_API void RecordServerRPC();
+
+	/** Counts a server RPC sent and how many bits it took. The average bytes per RPC are published along with the RPCs per second.*/
+	CAPSTONE_API void RecordSentRPC( const int64 Bits );
+}
+
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Equip" ), STAT_Equip, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "OnRep CurrentWeapon" ), STAT_OnRepCurrentWeapon, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Weapon Spawn" ), STAT_WeaponSpawn, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Fluid Anim Update" ), STAT_FluidAnimUpdate, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Fluid Anim Proxy Update" ), STAT_FluidAnimProxyUpdate, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Projectile Impact" ), STAT_ProjectileImpact, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Batched Projectile Simulate" ), STAT_BatchedProjectileSimulate, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Hit-Scan Resolve" ), STAT_HitScanResolve, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Damage Flush" ), STAT_DamageFlush, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Character Respawn" ), STAT_CharacterRespawn, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Server RPC HandleFire" ), STAT_ServerRPC_HandleFire, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Server RPC Equip" ), STAT_ServerRPC_Equip, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_CYCLE_STAT_EXTERN( TEXT( "Server RPC CustomizeWeapon" ), STAT_ServerRPC_CustomizeWeapon, STATGROUP_Capstone, CAPSTONE_API );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Server RPCs Per Second" ), STAT_ServerRPCsPerSecond, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Bytes Per Sent RPC" ), STAT_BytesPerSentRPC, STATGROUP_Capstone, CAPSTONE_API );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Weapon Swaps" ), STAT_WeaponSwaps, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Weapon Visibility Changes" ), STAT_WeaponVisibilityChanges, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Weapon Swap Allocations" ), STAT_WeaponSwapAllocations, STATGROUP_Capstone, CAPSTONE_API );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN( TEXT( "Aggregated Tick Weapons" ), STAT_AggregatedTickWeapons, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_DWORD_COUNTER_STAT_EXTERN( TEXT( "Aggregated Tick Projectiles" ), STAT_AggregatedTickProjectiles, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_DWORD_COUNTER_STAT_EXTERN( TEXT( "Simulated Ragdolls" ), STAT_SimulatedRagdolls, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Hit-Scan Traces" ), STAT_HitScanTraces, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Character Respawns" ), STAT_CharacterRespawns, STATGROUP_Capstone, CAPSTONE_API );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN( TEXT( "Respawn Objects Created" ), STAT_RespawnObjectsCreated, STATGROUP_Capstone, CAPSTONE_API );
@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CharacterPoolSubsystem.h"
+#include "CapstoneCharacter.h"
+#include "CapstoneStats.h"
+
+#include "Engine/World.h"
+#include "UObject/UObjectArray.h"
+
+DEFINE_LOG_CATEGORY( LogCharacterPool );
+
+bool UCharacterPoolSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCharacterPoolSubsystem::Deinitialize()
+{
+	UE_LOG( LogCharacterPool, Log, TEXT( "Character pool shutting down: %d hits, %d misses" ), PoolHits, PoolMisses );
+
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+void UCharacterPoolSubsystem::Prewarm( TSubclassOf<ACapstoneCharacter> CharacterClass, int32 Count )
+{
+	if ( !CharacterClass || GetWorld()->GetNetMode() == NM_Client ) return;
+
+	if ( Count <= 0 ) Count = DefaultPrewarmCount;
+
+	FCharacterPoolBucket& Bucket = Pools.FindOrAdd( CharacterClass );
+	const int32 Target = FMath::Min( Count, MaxPooledPerClass );
+
+	Bucket.Inactive.Reserve( Target );
+	while ( Bucket.Inactive.Num() < Target )
+	{
+		ACapstoneCharacter* Character = SpawnPooledCharacter( CharacterClass );
+		if ( !Character ) break;
+
+		Character->DeactivateToPool();
+		Bucket.Inactive.Add( Character );
+	}
+}
+
+ACapstoneCharacter* UCharacterPoolSubsystem::AcquireCharacter( TSubclassOf<ACapstoneCharacter> CharacterClass, const FTransform& SpawnTransform )
+{
+	if ( !CharacterClass ) return nullptr;
+
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_CharacterRespawn );
+
+	// Every object a respawn creates is one more for the garbage collector to reach and eventually free
+	const int32 ObjectsBefore = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	const double StartTime = FPlatformTime::Seconds();
+
+	ACapstoneCharacter* Character = nullptr;
+
+	if ( FCharacterPoolBucket* Bucket = Pools.Find( CharacterClass ) )
+	{
+		while ( !Character && Bucket->Inactive.Num() > 0 )
+		{
+			// Entries can go stale if something else destroyed a pooled character
+			Character = Bucket->Inactive.Pop( false );
+			if ( !IsValid( Character ) ) Character = nullptr;
+		}
+	}
+
+	if ( Character )
+	{
+		++PoolHits;
+	}
+	else
+	{
+		++PoolMisses;
+		Character = SpawnPooledCharacter( CharacterClass );
+		if ( !Character ) return nullptr;
+	}
+
+	Character->ActivateFromPool( SpawnTransform );
+
+	INC_DWORD_STAT( STAT_CharacterRespawns );
+	INC_DWORD_STAT_BY( STAT_RespawnObjectsCreated, FMath::Max( GUObjectArray.GetObjectArrayNumMinusAvailable() - ObjectsBefore, 0 ) );
+	UE_LOG( LogCharacterPool, Verbose, TEXT( "Respawned %s in %.2f ms" ), *Character->GetName(), ( FPlatformTime::Seconds() - StartTime ) * 1000.0 );
+
+	return Character;
+}
+
+void UCharacterPoolSubsystem::ReleaseCharacter( ACapstoneCharacter* Character )
+{
+	if ( !IsValid( Character ) ) return;
+
+	// A pooled character is either here already or travelled in pooled from the last map
+	FCharacterPoolBucket& Bucket = Pools.FindOrAdd( Character->GetClass() );
+	if ( Character->IsPooled() && Bucket.Inactive.Contains( Character ) ) return;
+
+	if ( Bucket.Inactive.Num() >= MaxPooledPerClass )
+	{
+		Character->Destroy();
+		return;
+	}
+
+	if ( !Character->IsPooled() ) Character->DeactivateToPool();
+	Bucket.Inactive.Add( Character );
+}
+
+int32 UCharacterPoolSubsystem::GetNumPooled( TSubclassOf<ACapstoneCharacter> CharacterClass ) const
+{
+	const FCharacterPoolBucket* Bucket = Pools.Find( CharacterClass );
+	return Bucket ? Bucket->Inactive.Num() : 0;
+}
+
+ACapstoneCharacter* UCharacterPoolSubsystem::SpawnPooledCharacter( TSubclassOf<ACapstoneCharacter> CharacterClass )
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParameters.ObjectFlags |= RF_Transient;
+
+	// Pooled characters are parked out of the way and only ever moved by ActivateFromPool
+	return GetWorld()->SpawnActor<ACapstoneCharacter>( CharacterClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParameters );
+}
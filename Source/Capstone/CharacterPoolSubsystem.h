@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterPoolSubsystem.generated.h"
+
+class ACapstoneCharacter;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogCharacterPool, Log, All );
+
+// Inactive characters of a single class, waiting to be respawned
+USTRUCT()
+struct FCharacterPoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<ACapstoneCharacter*> Inactive;
+};
+
+/**
+ * Keeps dead ACapstoneCharacters around and respawns them in place, so a respawn never has to construct the cameras,
+ * run BeginPlay or spawn the loadout again. Only the server owns pooled characters; clients see a pooled character
+ * as hidden and dormant until it is respawned. Used by ACapstoneGameMode for every default pawn it spawns.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API UCharacterPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Tops the pool up to at least Count inactive characters of the given class so a wave of respawns does not hitch.*/
+	UFUNCTION( BlueprintCallable, Category = "Character Pool" )
+	void Prewarm( TSubclassOf<ACapstoneCharacter> CharacterClass, int32 Count );
+
+	/** Takes a character out of the pool (or spawns one on a miss) and puts it into play at SpawnTransform.*/
+	UFUNCTION( BlueprintCallable, Category = "Character Pool" )
+	ACapstoneCharacter* AcquireCharacter( TSubclassOf<ACapstoneCharacter> CharacterClass, const FTransform& SpawnTransform );
+
+	/** Takes a character out of play and keeps it for reuse. It must not be possessed. Characters above MaxPooledPerClass are destroyed instead. Also takes in characters pooled in the map before seamless travel.*/
+	UFUNCTION( BlueprintCallable, Category = "Character Pool" )
+	void ReleaseCharacter( ACapstoneCharacter* Character );
+
+	UFUNCTION( BlueprintPure, Category = "Character Pool" )
+	FORCEINLINE int32 GetPoolHits() const { return PoolHits; }
+
+	UFUNCTION( BlueprintPure, Category = "Character Pool" )
+	FORCEINLINE int32 GetPoolMisses() const { return PoolMisses; }
+
+	UFUNCTION( BlueprintPure, Category = "Character Pool" )
+	int32 GetNumPooled( TSubclassOf<ACapstoneCharacter> CharacterClass ) const;
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	ACapstoneCharacter* SpawnPooledCharacter( TSubclassOf<ACapstoneCharacter> CharacterClass );
+
+	/** How many characters Prewarm spawns when called with a non-positive count.*/
+	UPROPERTY( config )
+	int32 DefaultPrewarmCount = 8;
+
+	/** Upper bound of inactive characters kept around per class.*/
+	UPROPERTY( config )
+	int32 MaxPooledPerClass = 32;
+
+	UPROPERTY()
+	TMap<TSubclassOf<ACapstoneCharacter>, FCharacterPoolBucket> Pools;
+
+	// Acquires served from the pool
+	int32 PoolHits = 0;
+
+	// Acquires that had to spawn a new character
+	int32 PoolMisses = 0;
+};
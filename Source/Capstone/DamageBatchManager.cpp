@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "DamageBatchManager.h"
+#include "CapstoneCharacter.h"
+#include "CapstoneGameMode.h"
+#include "HitScanSubsystem.h"
+#include "Weapon.h"
+#include "CapstoneNetStats.h"
+#include "CapstoneStats.h"
+
+#include "Engine/World.h"
+#include "EngineUtils.h"
+
+DEFINE_LOG_CATEGORY( LogCapstoneDamage );
+
+ADamageBatchManager::ADamageBatchManager()
+{
+	// Damage is resolved after everything that can deal it this frame has run
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	SetReplicatingMovement( false );
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>( TEXT( "Root" ) );
+}
+
+ADamageBatchManager* ADamageBatchManager::Get( const UObject* WorldContextObject )
+{
+	UWorld* World = GEngine->GetWorldFromContextObject( WorldContextObject, EGetWorldErrorMode::ReturnNull );
+	if ( !World ) return nullptr;
+
+	for ( TActorIterator<ADamageBatchManager> It( World ); It; ++It )
+	{
+		return *It;
+	}
+
+	if ( World->GetNetMode() == NM_Client ) return nullptr;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return World->SpawnActor<ADamageBatchManager>( SpawnParameters );
+}
+
+void ADamageBatchManager::QueueDamage( ACapstoneCharacter* Victim, const float Damage, AActor* DamageInstigator )
+{
+	if ( !HasAuthority() || !Victim || Damage <= 0.0f ) return;
+
+	FPendingDamage& Pending = PendingDamage.FindOrAdd( Victim );
+	Pending.Damage += Damage;
+	Pending.Hits++;
+
+	// The last hit of the frame gets the credit, it is the one that would have landed the kill
+	if ( DamageInstigator ) Pending.Instigator = DamageInstigator;
+
+	INC_DWORD_STAT( STAT_DamageHitsQueued );
+}
+
+void ADamageBatchManager::QueueHitScanImpact( const FHitScanImpactRecord& Impact )
+{
+	if ( !HasAuthority() || !Impact.WeaponClass ) return;
+
+	Impacts.Add( Impact );
+}
+
+void ADamageBatchManager::Tick( float DeltaTime )
+{
+	Super::Tick( DeltaTime );
+
+	if ( !HasAuthority() ) return;
+
+	if ( PendingDamage.Num() > 0 ) FlushDamage();
+
+	if ( Impacts.Num() > 0 )
+	{
+		INC_DWORD_STAT_BY( STAT_HitScanImpactsSent, Impacts.Num() );
+		Multicast_HitScanImpacts( Impacts );
+		Impacts.Reset();
+	}
+}
+
+void ADamageBatchManager::FlushDamage()
+{
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_DamageFlush );
+
+	Events.Reset();
+
+	for ( const TPair<TWeakObjectPtr<ACapstoneCharacter>, FPendingDamage>& Pair : PendingDamage )
+	{
+		ACapstoneCharacter* Victim = Pair.Key.Get();
+		if ( !Victim || Victim->IsDead() ) continue;
+
+		const FPendingDamage& Pending = Pair.Value;
+		const float HealthBefore = Victim->GetCurrentHealth();
+		Victim->SetCurrentHealth( HealthBefore - Pending.Damage );
+
+		FDamageEventRecord& Event = Events.AddDefaulted_GetRef();
+		Event.Victim = Victim;
+		Event.Instigator = Pending.Instigator.Get();
+		Event.Damage = static_cast<uint16>( FMath::Clamp( FMath::RoundToInt( HealthBefore - Victim->GetCurrentHealth() ), 0, MAX_uint16 ) );
+		Event.Hits = static_cast<uint8>( FMath::Min( Pending.Hits, static_cast<int32>( MAX_uint8 ) ) );
+		Event.bKilled = Victim->IsDead();
+
+		if ( Event.bKilled )
+		{
+			UE_LOG( LogCapstoneDamage, Verbose, TEXT( "%s killed by %s" ), *Victim->GetName(), *GetNameSafe( Event.Instigator ) );
+
+			if ( ACapstoneGameMode* GameMode = GetWorld()->GetAuthGameMode<ACapstoneGameMode>() ) GameMode->NotifyKilled( Victim );
+		}
+	}
+
+	PendingDamage.Reset();
+
+	if ( Events.Num() == 0 ) return;
+
+	INC_DWORD_STAT_BY( STAT_DamageEventsSent, Events.Num() );
+	Multicast_DamageEvents( Events );
+}
+
+void ADamageBatchManager::Multicast_DamageEvents_Implementation( const TArray<FDamageEventRecord>& InEvents )
+{
+	BroadcastDamageEvents( InEvents );
+}
+
+void ADamageBatchManager::BroadcastDamageEvents( const TArray<FDamageEventRecord>& InEvents )
+{
+	for ( const FDamageEventRecord& Event : InEvents )
+	{
+		// Remote victims never took damage on this machine, being hit is what marks them as in combat here
+		if ( Event.Victim ) Event.Victim->NotifyCombat();
+
+		DamageEventDelegate.Broadcast( Event.Victim, Event.Instigator, Event.Damage, Event.Hits, Event.bKilled );
+	}
+}
+
+void ADamageBatchManager::Multicast_HitScanImpacts_Implementation( const TArray<FHitScanImpactRecord>& InImpacts )
+{
+	UHitScanSubsystem* HitScan = GetWorld()->GetSubsystem<UHitScanSubsystem>();
+	if ( !HitScan ) return;
+
+	for ( const FHitScanImpactRecord& Impact : InImpacts )
+	{
+		// The shooter drew its own pellets when it fired
+		const APawn* Shooter = Cast<APawn>( Impact.Shooter );
+		if ( Shooter && Shooter->IsLocallyControlled() ) continue;
+
+		HitScan->PlayPelletEffects( Impact.WeaponClass.GetDefaultObject(), Impact.Start, Impact.End, Impact.bImpact );
+	}
+}
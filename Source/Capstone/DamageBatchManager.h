@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "DamageBatchManager.generated.h"
+
+class ACapstoneCharacter;
+class AWeapon;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogCapstoneDamage, Log, All );
+
+// Everything one target took in a frame, sent to clients for hit markers and the kill feed
+USTRUCT()
+struct FDamageEventRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	ACapstoneCharacter* Victim = nullptr;
+
+	UPROPERTY()
+	AActor* Instigator = nullptr;
+
+	// Total damage of the frame, whole points are enough for hit markers
+	UPROPERTY()
+	uint16 Damage = 0;
+
+	// Number of hits the damage was summed from
+	UPROPERTY()
+	uint8 Hits = 0;
+
+	UPROPERTY()
+	bool bKilled = false;
+};
+
+// Where one hit-scan pellet went, sent to clients so they can draw it
+USTRUCT()
+struct FHitScanImpactRecord
+{
+	GENERATED_BODY()
+
+	// The effects come from the class default, the weapon itself may not be relevant to every client
+	UPROPERTY()
+	TSubclassOf<AWeapon> WeaponClass;
+
+	UPROPERTY()
+	AActor* Shooter = nullptr;
+
+	UPROPERTY()
+	FVector_NetQuantize Start;
+
+	UPROPERTY()
+	FVector_NetQuantize End;
+
+	// Whether the pellet stopped on something at End rather than running out of range
+	UPROPERTY()
+	bool bImpact = false;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FiveParams( FDamageEventDelegate, class ACapstoneCharacter*, Victim, AActor*, Instigator, float, Damage, int32, Hits, bool, bKilled );
+
+/**
+ * Collects every hit the server applies to characters during a frame and resolves them once per target at the end
+ * of the frame. A shotgun blast or an explosion then costs a single health change, one dirty mark and one OnRep per
+ * victim, and all hit markers and kills of the frame go to clients in a single unreliable multicast. Hit-scan tracers
+ * and impacts of the frame are batched into another one the same way.
+ */
+UCLASS()
+class CAPSTONE_API ADamageBatchManager : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ADamageBatchManager();
+
+	/** Finds the manager of the world, spawning it on the server if it does not exist yet.*/
+	static ADamageBatchManager* Get( const UObject* WorldContextObject );
+
+	/** Queues Damage against Victim for the end of the frame. Server only.*/
+	void QueueDamage( ACapstoneCharacter* Victim, const float Damage, AActor* DamageInstigator );
+
+	/** Queues a hit-scan pellet to be drawn on clients at the end of the frame. Server only.*/
+	void QueueHitScanImpact( const FHitScanImpactRecord& Impact );
+
+	virtual void Tick( float DeltaTime ) override;
+
+	/** Called on every machine for each event of a flushed frame. Hook hit markers and the kill feed up to this.*/
+	UPROPERTY( BlueprintAssignable, Category = "Delegates" )
+	FDamageEventDelegate DamageEventDelegate;
+
+protected:
+	struct FPendingDamage
+	{
+		float Damage = 0.0f;
+		int32 Hits = 0;
+		TWeakObjectPtr<AActor> Instigator;
+	};
+
+	/** Applies the queued damage of the frame and sends its events.*/
+	void FlushDamage();
+
+	UFUNCTION( NetMulticast, Unreliable )
+	void Multicast_DamageEvents( const TArray<FDamageEventRecord>& InEvents );
+
+	void BroadcastDamageEvents( const TArray<FDamageEventRecord>& InEvents );
+
+	UFUNCTION( NetMulticast, Unreliable )
+	void Multicast_HitScanImpacts( const TArray<FHitScanImpactRecord>& InImpacts );
+
+	// Damage queued this frame, in the order the targets were first hit
+	TMap<TWeakObjectPtr<ACapstoneCharacter>, FPendingDamage> PendingDamage;
+
+	// Scratch buffer reused every flush
+	TArray<FDamageEventRecord> Events;
+
+	// Hit-scan pellets resolved this frame
+	TArray<FHitScanImpactRecord> Impacts;
+};
@@ -2,9 +2,115 @@
 
 #include "FluidAnimInstance.h"
 #include "CapstoneCharacter.h"
+#include "CapstoneStats.h"
 
 #include "Camera/CameraComponent.h"
 
+#include <atomic>
+
+// Gathered from every worker thread that updates a proxy, read once per frame by UCapstoneSignificanceManager
+static std::atomic<uint64> GIKUpdateCycles { 0 };
+static std::atomic<int32> GIKUpdates { 0 };
+static std::atomic<uint64> GBaseUpdateCycles { 0 };
+static std::atomic<int32> GBaseUpdates { 0 };
+
+FFluidAnimUpdateCost FFluidAnimInstanceProxy::ConsumeUpdateCost()
+{
+	FFluidAnimUpdateCost Cost;
+	Cost.IKMs = FPlatformTime::ToMilliseconds64( GIKUpdateCycles.exchange( 0, std::memory_order_relaxed ) );
+	Cost.IKUpdates = GIKUpdates.exchange( 0, std::memory_order_relaxed );
+	Cost.BaseMs = FPlatformTime::ToMilliseconds64( GBaseUpdateCycles.exchange( 0, std::memory_order_relaxed ) );
+	Cost.BaseUpdates = GBaseUpdates.exchange( 0, std::memory_order_relaxed );
+	return Cost;
+}
+
+void FFluidAnimInstanceProxy::PreUpdate( UAnimInstance* InAnimInstance, float DeltaSeconds )
+{
+	Super::PreUpdate( InAnimInstance, DeltaSeconds );
+
+	const UFluidAnimInstance* Instance = CastChecked<UFluidAnimInstance>( InAnimInstance );
+	ACapstoneCharacter* Character = Instance->Character;
+	const USkeletalMeshComponent* Mesh = Instance->Mesh;
+
+	bUpdateIK = Character && Mesh && Instance->ShouldUpdateIK();
+	if ( !bUpdateIK ) return;
+
+	if ( CachedMeshAsset != Mesh->GetSkeletalMeshAsset() ) CacheBoneIndices( Mesh );
+
+	CameraLocation = Character->GetCamera()->GetComponentLocation();
+	AimRotation = Character->GetBaseAimRotation();
+
+	const TArray<FTransform>& ComponentSpaceTransforms = Mesh->GetComponentSpaceTransforms();
+	RootBoneComponentTransform = ComponentSpaceTransforms.IsValidIndex( RootBoneIndex ) ? ComponentSpaceTransforms[RootBoneIndex] : FTransform::Identity;
+	HandRootWorldTransform = ComponentSpaceTransforms.IsValidIndex( HandRootBoneIndex ) ? ComponentSpaceTransforms[HandRootBoneIndex] * Mesh->GetComponentTransform() : Mesh->GetComponentTransform();
+
+	SwayStrength = Instance->SwayStrength;
+	SwayInterpSpeed = Instance->SwayInterpSpeed;
+	MaxSway = Instance->MaxSway;
+	WeaponRecoil = Instance->Weapon ? Instance->Weapon->Recoil : FRotator::ZeroRotator;
+}
+
+void FFluidAnimInstanceProxy::Update( float DeltaSeconds )
+{
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_FluidAnimProxyUpdate );
+
+	// Measured in every build, the significance manager budgets with it
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	Super::Update( DeltaSeconds );
+
+	if ( bUpdateIK )
+	{
+		SetVariables( DeltaSeconds );
+		CalculateWeaponSway( DeltaSeconds );
+	}
+
+	const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+	( bUpdateIK ? GIKUpdateCycles : GBaseUpdateCycles ).fetch_add( Cycles, std::memory_order_relaxed );
+	( bUpdateIK ? GIKUpdates : GBaseUpdates ).fetch_add( 1, std::memory_order_relaxed );
+}
+
+void FFluidAnimInstanceProxy::PostUpdate( UAnimInstance* InAnimInstance ) const
+{
+	Super::PostUpdate( InAnimInstance );
+
+	if ( !bUpdateIK ) return;
+
+	UFluidAnimInstance* Instance = CastChecked<UFluidAnimInstance>( InAnimInstance );
+	Instance->CameraTransform = CameraTransform;
+	Instance->RelativeCameraTransform = RelativeCameraTransform;
+	Instance->WeaponSway = WeaponSway;
+	Instance->WeaponRecoil = WeaponRecoil;
+}
+
+void FFluidAnimInstanceProxy::CacheBoneIndices( const USkeletalMeshComponent* Mesh )
+{
+	static const FName RootBoneName( "root" );
+	static const FName HandRootBoneName( "ik_hand_root" );
+
+	CachedMeshAsset = Mesh->GetSkeletalMeshAsset();
+	RootBoneIndex = Mesh->GetBoneIndex( RootBoneName );
+	HandRootBoneIndex = Mesh->GetBoneIndex( HandRootBoneName );
+}
+
+void FFluidAnimInstanceProxy::SetVariables( const float DeltaTime )
+{
+	CameraTransform = FTransform( AimRotation, CameraLocation );
+
+	const FTransform& RootOffset = RootBoneComponentTransform.Inverse() * HandRootWorldTransform;
+	RelativeCameraTransform = CameraTransform.GetRelativeTransform( RootOffset );
+}
+
+void FFluidAnimInstanceProxy::CalculateWeaponSway( const float DeltaTime )
+{
+	// The weapon trails behind the aim and springs back once the aim stops moving
+	const FRotator AimDelta = ( AimRotation - LastAimRotation ).GetNormalized();
+	LastAimRotation = AimRotation;
+
+	const FRotator TargetSway( FMath::Clamp( -AimDelta.Pitch * SwayStrength, -MaxSway, MaxSway ), FMath::Clamp( -AimDelta.Yaw * SwayStrength, -MaxSway, MaxSway ), 0.0f );
+	WeaponSway = FMath::RInterpTo( WeaponSway, TargetSway, DeltaTime, SwayInterpSpeed );
+}
+
 UFluidAnimInstance::UFluidAnimInstance()
 {
 
@@ -17,8 +123,11 @@ void UFluidAnimInstance::NativeBeginPlay()
 
 void UFluidAnimInstance::NativeUpdateAnimation( float deltaTime )
 {
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_FluidAnimUpdate );
+
 	Super::NativeUpdateAnimation( deltaTime );
 
+	// Everything per frame happens in FFluidAnimInstanceProxy, this only binds to the character once
 	if ( !Character )
 	{
 		Character = Cast<ACapstoneCharacter>( TryGetPawnOwner() );
@@ -28,11 +137,13 @@ void UFluidAnimInstance::NativeUpdateAnimation( float deltaTime )
 			Character->CurrentWeaponChangeDelegate.AddDynamic( this, &UFluidAnimInstance::CurrentWeaponChanged );
 			CurrentWeaponChanged( Character->CurrentWeapon, nullptr );
 		}
-		else return;
 	}
+}
 
-	SetVariables( deltaTime );
-	CalculateWeaponSway( deltaTime );
+bool UFluidAnimInstance::ShouldUpdateIK() const
+{
+	if ( Character->IsLocallyControlled() ) return true;
+	return bIKAllowedBySignificance && Mesh->WasRecentlyRendered( IKVisibilityGracePeriod );
 }
 
 void UFluidAnimInstance::CurrentWeaponChanged( AWeapon* NewWeapon, const AWeapon* OldWeapon )
@@ -41,7 +152,7 @@ void UFluidAnimInstance::CurrentWeaponChanged( AWeapon* NewWeapon, const AWeapon
 	if ( Weapon )
 	{
 		IKProperties = Weapon->IKProperties;
-		GetWorld()->GetTimerManager().SetTimerForNextTick( this, &UFluidAnimInstance::SetIKTransforms );
+		SetIKTransforms();
 	}
 	else
 	{
@@ -49,20 +160,8 @@ void UFluidAnimInstance::CurrentWeaponChanged( AWeapon* NewWeapon, const AWeapon
 	}
 }
 
-void UFluidAnimInstance::SetVariables( const float deltaTime )
-{
-	CameraTransform = FTransform(Character->GetBaseAimRotation(), Character->GetCamera()->GetComponentLocation() );
-
-	const FTransform& RootOffset = Mesh->GetSocketTransform( FName( "root" ), RTS_Component ).Inverse() * Mesh->GetSocketTransform( FName( "ik_hand_root" ) );
-	RelativeCameraTransform = CameraTransform.GetRelativeTransform( RootOffset );
-}
-
-void UFluidAnimInstance::CalculateWeaponSway( const float deltaTime )
-{
-
-}
-
 void UFluidAnimInstance::SetIKTransforms( )
 {
-	HandToSightsTransform = Weapon->GetSightsWorldTransform().GetRelativeTransform( Mesh->GetSocketTransform( FName( "weapon_r" ) ) );
-}
\ No newline at end of file
+	// Precomputed by ACapstoneCharacter::AttachWeapon, nothing to wait a tick for
+	if ( Weapon ) HandToSightsTransform = Weapon->HandToSightsTransform;
+}
@@ -4,9 +4,70 @@
 
 #include "CoreMinimal.h"
 #include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
 #include "Weapon.h"
 #include "FluidAnimInstance.generated.h"
 
+// Time the animation worker threads spent in proxy updates, split by whether IK ran
+struct FFluidAnimUpdateCost
+{
+	double IKMs = 0.0;
+	int32 IKUpdates = 0;
+	double BaseMs = 0.0;
+	int32 BaseUpdates = 0;
+};
+
+/**
+ * Runs the per-frame IK and sway math of UFluidAnimInstance on an animation worker thread.
+ * PreUpdate snapshots the character on the game thread, Update does the math, PostUpdate copies the results
+ * back into the instance's Blueprint-visible variables.
+ */
+USTRUCT()
+struct CAPSTONE_API FFluidAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	FFluidAnimInstanceProxy() = default;
+	FFluidAnimInstanceProxy( UAnimInstance* Instance ) : FAnimInstanceProxy( Instance ) {}
+
+	/** Returns the update time measured across all proxies since the last call and starts over. Game thread only.*/
+	static FFluidAnimUpdateCost ConsumeUpdateCost();
+
+protected:
+	friend struct FCapstoneBenchmarks;
+
+	virtual void PreUpdate( UAnimInstance* InAnimInstance, float DeltaSeconds ) override;
+	virtual void Update( float DeltaSeconds ) override;
+	virtual void PostUpdate( UAnimInstance* InAnimInstance ) const override;
+
+	void SetVariables( const float DeltaTime );
+	void CalculateWeaponSway( const float DeltaTime );
+
+	/** Looks up the bone indices used every frame. Done once and again only if the skeletal mesh changes.*/
+	void CacheBoneIndices( const USkeletalMeshComponent* Mesh );
+
+	int32 RootBoneIndex = INDEX_NONE;
+	int32 HandRootBoneIndex = INDEX_NONE;
+	const USkeletalMesh* CachedMeshAsset = nullptr;
+
+	// Game thread snapshot
+	bool bUpdateIK = false;
+	FVector CameraLocation = FVector::ZeroVector;
+	FRotator AimRotation = FRotator::ZeroRotator;
+	FTransform RootBoneComponentTransform;
+	FTransform HandRootWorldTransform;
+	float SwayStrength = 0.0f;
+	float SwayInterpSpeed = 0.0f;
+	float MaxSway = 0.0f;
+	FRotator WeaponRecoil = FRotator::ZeroRotator;
+
+	// Worker thread results
+	FTransform CameraTransform;
+	FTransform RelativeCameraTransform;
+	FRotator LastAimRotation = FRotator::ZeroRotator;
+	FRotator WeaponSway = FRotator::ZeroRotator;
+};
+
 UCLASS()
 class CAPSTONE_API UFluidAnimInstance : public UAnimInstance
 {
@@ -16,17 +77,25 @@ public:
 	UFluidAnimInstance();
 
 protected:
+	friend struct FFluidAnimInstanceProxy;
+
+	/** IK only matters for pawns someone looks at: the local player's own pawn or one that was rendered recently.*/
+	virtual bool ShouldUpdateIK() const;
+
 	virtual void NativeBeginPlay() override;
 	virtual void NativeUpdateAnimation( float DeltaTime ) override;
 
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override { return &Proxy; }
+	virtual void DestroyAnimInstanceProxy( FAnimInstanceProxy* InProxy ) override {}
+
 	UFUNCTION()
 	virtual void CurrentWeaponChanged( class AWeapon* NewWeapon, const class AWeapon* OldWeapon );
 
-	virtual void SetVariables( const float deltaTime );
-	virtual void CalculateWeaponSway( const float deltaTime );
-
 	virtual void SetIKTransforms();
 
+	UPROPERTY( Transient )
+	FFluidAnimInstanceProxy Proxy;
+
 public:
 	/// *****************************
 	/// Character References
@@ -54,4 +123,35 @@ public:
 
 	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Animation" )
 	FTransform HandToSightsTransform;
+
+	/** Seconds after a remote pawn was last rendered during which its IK keeps updating.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Animation" )
+	float IKVisibilityGracePeriod = 0.2f;
+
+	/** Cleared by UCapstoneSignificanceManager when the character is animated below the full tier.*/
+	UPROPERTY( Transient, BlueprintReadOnly, Category = "Animation" )
+	bool bIKAllowedBySignificance = true;
+
+	/// *****************************
+	/// Weapon Sway
+	/// *****************************
+	/** Rotation offset of the weapon lagging behind the aim, computed every update.*/
+	UPROPERTY( BlueprintReadOnly, Category = "Animation|Sway" )
+	FRotator WeaponSway;
+
+	/** The current weapon's recoil, recovered by UAggregatedTickSubsystem.*/
+	UPROPERTY( BlueprintReadOnly, Category = "Animation|Sway" )
+	FRotator WeaponRecoil;
+
+	/** How much of the aim rotation change per update turns into sway.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Animation|Sway" )
+	float SwayStrength = 0.5f;
+
+	/** How quickly the sway settles back to zero.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Animation|Sway" )
+	float SwayInterpSpeed = 8.0f;
+
+	/** Largest sway angle in degrees on each axis.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Animation|Sway" )
+	float MaxSway = 5.0f;
 };
@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "HitScanSubsystem.h"
+#include "Weapon.h"
+#include "CapstoneCharacter.h"
+#include "LagCompensationSubsystem.h"
+#include "DamageBatchManager.h"
+#include "CapstoneStats.h"
+
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+
+bool UHitScanSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UHitScanSubsystem::Initialize( FSubsystemCollectionBase& Collection )
+{
+	Super::Initialize( Collection );
+
+	TraceDelegate.BindUObject( this, &UHitScanSubsystem::OnTraceCompleted );
+}
+
+FRandomStream UHitScanSubsystem::GetSpreadStream( const AActor* Shooter, const uint16 PredictionKey )
+{
+	// Player ids replicate, so the shooting client and the server derive the same seed
+	const APawn* Pawn = Cast<APawn>( Shooter );
+	const int32 PlayerId = Pawn && Pawn->GetPlayerState() ? Pawn->GetPlayerState()->GetPlayerId() : 0;
+	return FRandomStream( static_cast<int32>( HashCombine( GetTypeHash( PlayerId ), GetTypeHash( PredictionKey ) ) ) );
+}
+
+void UHitScanSubsystem::Fire( AWeapon* Weapon, AActor* Shooter, const FVector& Origin, const FVector& Direction, const uint16 PredictionKey, const float RewindSeconds )
+{
+	UWorld* World = GetWorld();
+	if ( !Weapon || World->GetNetMode() == NM_Client ) return;
+
+	const ULagCompensationSubsystem* LagCompensation = World->GetSubsystem<ULagCompensationSubsystem>();
+
+	const uint32 ShotId = NextShotId++;
+	FHitScanShot& Shot = PendingShots.Add( ShotId );
+	Shot.Weapon = Weapon;
+	Shot.Shooter = Shooter;
+	Shot.RewoundTime = World->GetTimeSeconds() - ( LagCompensation ? LagCompensation->ClampRewind( RewindSeconds ) : 0.0f );
+	Shot.PendingPellets = FMath::Max( Weapon->PelletCount, 1 );
+
+	// Characters are tested against their rewound hitboxes when the trace comes back, not against where they are now
+	FCollisionQueryParams Params( SCENE_QUERY_STAT( HitScanTrace ), false, Shooter );
+	Params.AddIgnoredActor( Weapon );
+	if ( LagCompensation )
+	{
+		for ( ACapstoneCharacter* Character : LagCompensation->GetCharacters() ) Params.AddIgnoredActor( Character );
+	}
+
+	TracePellets( Shot, ShotId, Origin, Direction, PredictionKey, Params );
+	INC_DWORD_STAT_BY( STAT_HitScanTraces, Shot.PendingPellets );
+}
+
+void UHitScanSubsystem::FireCosmetic( AWeapon* Weapon, AActor* Shooter, const FVector& Origin, const FVector& Direction, const uint16 PredictionKey )
+{
+	if ( !Weapon || GetWorld()->GetNetMode() == NM_DedicatedServer ) return;
+
+	const uint32 ShotId = NextShotId++;
+	FHitScanShot& Shot = PendingShots.Add( ShotId );
+	Shot.Weapon = Weapon;
+	Shot.Shooter = Shooter;
+	Shot.PendingPellets = FMath::Max( Weapon->PelletCount, 1 );
+	Shot.bCosmetic = true;
+
+	// Drawn against what the shooter sees, characters included
+	FCollisionQueryParams Params( SCENE_QUERY_STAT( HitScanCosmeticTrace ), false, Shooter );
+	Params.AddIgnoredActor( Weapon );
+
+	TracePellets( Shot, ShotId, Origin, Direction, PredictionKey, Params );
+}
+
+void UHitScanSubsystem::TracePellets( const FHitScanShot& Shot, const uint32 ShotId, const FVector& Origin, const FVector& Direction, const uint16 PredictionKey, const FCollisionQueryParams& Params )
+{
+	const AWeapon* Weapon = Shot.Weapon.Get();
+	FRandomStream SpreadStream = GetSpreadStream( Shot.Shooter.Get(), PredictionKey );
+
+	// All pellets of the shot go out together with the same id
+	const FVector Forward = Direction.GetSafeNormal();
+	const float SpreadRadians = FMath::DegreesToRadians( Weapon->PelletSpread );
+	for ( int32 Pellet = 0; Pellet < Shot.PendingPellets; ++Pellet )
+	{
+		const FVector PelletDirection = SpreadRadians > 0.0f ? SpreadStream.VRandCone( Forward, SpreadRadians ) : Forward;
+		GetWorld()->AsyncLineTraceByChannel( EAsyncTraceType::Single, Origin, Origin + PelletDirection * Weapon->HitScanRange, ECC_Visibility, Params, FCollisionResponseParams::DefaultResponseParam, &TraceDelegate, ShotId );
+	}
+}
+
+void UHitScanSubsystem::OnTraceCompleted( const FTraceHandle& Handle, FTraceDatum& Datum )
+{
+	FHitScanShot* Shot = PendingShots.Find( Datum.UserData );
+	if ( !Shot ) return;
+
+	const FHitResult* WorldHit = Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit ? &Datum.OutHits[0] : nullptr;
+	if ( Shot->bCosmetic ) PlayPelletEffects( Shot->Weapon.Get(), Datum.Start, WorldHit ? WorldHit->ImpactPoint : Datum.End, WorldHit != nullptr );
+	else ResolvePellet( *Shot, Datum.Start, Datum.End, WorldHit );
+
+	if ( --Shot->PendingPellets <= 0 ) PendingShots.Remove( Datum.UserData );
+}
+
+void UHitScanSubsystem::ResolvePellet( const FHitScanShot& Shot, const FVector& Start, const FVector& End, const FHitResult* WorldHit )
+{
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_HitScanResolve );
+
+	AWeapon* Weapon = Shot.Weapon.Get();
+	if ( !Weapon ) return;
+
+	AActor* Shooter = Shot.Shooter.Get();
+	FHitResult Hit = WorldHit ? *WorldHit : FHitResult();
+
+	// Only characters in front of whatever the world trace hit can be struck
+	FHitResult RewoundHit;
+	const ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	if ( LagCompensation && LagCompensation->SweepRewound( Start, WorldHit ? WorldHit->Location : End, 0.0f, Shot.RewoundTime, Shooter, RewoundHit ) )
+	{
+		Hit = RewoundHit;
+	}
+
+	// Every client but the shooter's, which drew the pellet already, sees where it went
+	if ( ADamageBatchManager* DamageManager = ADamageBatchManager::Get( this ) )
+	{
+		FHitScanImpactRecord Impact;
+		Impact.WeaponClass = Weapon->GetClass();
+		Impact.Shooter = Shooter;
+		Impact.Start = Start;
+		Impact.End = Hit.bBlockingHit ? Hit.ImpactPoint : End;
+		Impact.bImpact = Hit.bBlockingHit;
+		DamageManager->QueueHitScanImpact( Impact );
+	}
+
+	AActor* HitActor = Hit.GetActor();
+	if ( !HitActor ) return;
+
+	const APawn* InstigatorPawn = Cast<APawn>( Shooter );
+	UGameplayStatics::ApplyPointDamage( HitActor, Weapon->HitScanDamage, ( End - Start ).GetSafeNormal(), Hit, InstigatorPawn ? InstigatorPawn->GetController() : nullptr, Weapon, Weapon->HitScanDamageType );
+}
+
+void UHitScanSubsystem::PlayPelletEffects( const AWeapon* Weapon, const FVector& Start, const FVector& End, const bool bImpact ) const
+{
+	if ( !Weapon || GetWorld()->GetNetMode() == NM_DedicatedServer ) return;
+
+	if ( Weapon->TracerEffect )
+	{
+		UParticleSystemComponent* Tracer = UGameplayStatics::SpawnEmitterAtLocation( GetWorld(), Weapon->TracerEffect, Start, ( End - Start ).Rotation(), true, EPSCPoolMethod::AutoRelease );
+		if ( Tracer ) Tracer->SetVectorParameter( Weapon->TracerEndParameter, End );
+	}
+
+	if ( bImpact && Weapon->HitScanImpactEffect )
+	{
+		UGameplayStatics::SpawnEmitterAtLocation( GetWorld(), Weapon->HitScanImpactEffect, End, ( Start - End ).Rotation(), true, EPSCPoolMethod::AutoRelease );
+	}
+}
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "HitScanSubsystem.generated.h"
+
+class AWeapon;
+
+/**
+ * Resolves hit-scan shots on the server. Every pellet of every shot fired during a frame is submitted as an async line
+ * trace, which the physics scene runs in parallel with the rest of the frame; the results are read back at the start
+ * of the next frame. The world traces ignore characters, those are tested against their rewound hitboxes from
+ * ULagCompensationSubsystem, the same way batched projectiles hit them. Where each pellet stopped goes to clients in the
+ * batched impact multicast of ADamageBatchManager; the shooter draws its own tracers right away from a cosmetic trace.
+ * Pellet spread is seeded from the shooter and the shot's prediction key, so client, server and replays agree on it.
+ */
+UCLASS()
+class CAPSTONE_API UHitScanSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Fires Weapon's pellets from Origin along Direction. Characters are tested as they were RewindSeconds ago. Server only.*/
+	void Fire( AWeapon* Weapon, AActor* Shooter, const FVector& Origin, const FVector& Direction, const uint16 PredictionKey, const float RewindSeconds );
+
+	/** Traces the same pellets as Fire against what this machine sees and only draws them. For the locally controlled shooter.*/
+	void FireCosmetic( AWeapon* Weapon, AActor* Shooter, const FVector& Origin, const FVector& Direction, const uint16 PredictionKey );
+
+	/** Draws one pellet's tracer and, if it hit something, its impact. Does nothing on a dedicated server.*/
+	void PlayPelletEffects( const AWeapon* Weapon, const FVector& Start, const FVector& End, const bool bImpact ) const;
+
+	/** Spread of a shot, the same on every machine for the same shooter and prediction key.*/
+	static FRandomStream GetSpreadStream( const AActor* Shooter, const uint16 PredictionKey );
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+	virtual void Initialize( FSubsystemCollectionBase& Collection ) override;
+
+	// Everything a pellet needs once its trace comes back
+	struct FHitScanShot
+	{
+		TWeakObjectPtr<AWeapon> Weapon;
+		TWeakObjectPtr<AActor> Shooter;
+		float RewoundTime = 0.0f;
+		int32 PendingPellets = 0;
+
+		// Only drawn, never resolved
+		bool bCosmetic = false;
+	};
+
+	/** Submits one async trace per pellet, all with ShotId as user data.*/
+	void TracePellets( const FHitScanShot& Shot, const uint32 ShotId, const FVector& Origin, const FVector& Direction, const uint16 PredictionKey, const FCollisionQueryParams& Params );
+
+	void OnTraceCompleted( const FTraceHandle& Handle, FTraceDatum& Datum );
+
+	/** Applies the damage of one pellet, whichever of the world hit and the rewound character hit is closer.*/
+	void ResolvePellet( const FHitScanShot& Shot, const FVector& Start, const FVector& End, const FHitResult* WorldHit );
+
+	FTraceDelegate TraceDelegate;
+
+	// Shots waiting on their traces, keyed by the id passed as trace user data
+	TMap<uint32, FHitScanShot> PendingShots;
+
+	uint32 NextShotId = 0;
+};
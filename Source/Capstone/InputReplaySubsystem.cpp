@@ -0,0 +1,358 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InputReplaySubsystem.h"
+#include "CapstoneCharacter.h"
+
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "InputActionValue.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY( LogInputReplay );
+
+namespace
+{
+	const uint32 TimelineMagic = 0x50524943; // "CIRP"
+	const uint8 TimelineVersion = 1;
+
+	UInputReplaySubsystem* GetReplaySubsystem( UWorld* World )
+	{
+		return World ? World->GetSubsystem<UInputReplaySubsystem>() : nullptr;
+	}
+}
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs InputRecordCommand(
+	TEXT( "Capstone.InputRecord" ),
+	TEXT( "Starts recording the local character's input. Usage: Capstone.InputRecord [OutputFile]" ),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda( []( const TArray<FString>& Args, UWorld* World )
+	{
+		if ( UInputReplaySubsystem* Replay = GetReplaySubsystem( World ) ) Replay->StartRecording( Args.Num() > 0 ? Args[0] : FString() );
+	} ) );
+
+static FAutoConsoleCommandWithWorldAndArgs InputRecordStopCommand(
+	TEXT( "Capstone.InputRecordStop" ),
+	TEXT( "Stops recording input and writes the timeline." ),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda( []( const TArray<FString>& Args, UWorld* World )
+	{
+		if ( UInputReplaySubsystem* Replay = GetReplaySubsystem( World ) ) Replay->StopRecording();
+	} ) );
+
+static FAutoConsoleCommandWithWorldAndArgs InputReplayCommand(
+	TEXT( "Capstone.InputReplay" ),
+	TEXT( "Replays a recorded input timeline on the local character. Usage: Capstone.InputReplay <File>" ),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda( []( const TArray<FString>& Args, UWorld* World )
+	{
+		UInputReplaySubsystem* Replay = GetReplaySubsystem( World );
+		if ( Replay && Args.Num() > 0 ) Replay->StartReplay( Args[0] );
+	} ) );
+#endif
+
+bool UInputReplaySubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UInputReplaySubsystem::Initialize( FSubsystemCollectionBase& Collection )
+{
+	Super::Initialize( Collection );
+
+	bFixedTimeStep = !FParse::Param( FCommandLine::Get(), TEXT( "InputReplayRealTime" ) );
+
+	FString Path;
+	if ( FParse::Value( FCommandLine::Get(), TEXT( "InputReplay=" ), Path ) )
+	{
+		StartReplay( Path );
+	}
+	else if ( FParse::Value( FCommandLine::Get(), TEXT( "InputRecord=" ), Path ) || FParse::Param( FCommandLine::Get(), TEXT( "InputRecord" ) ) )
+	{
+		StartRecording( Path );
+	}
+}
+
+void UInputReplaySubsystem::Deinitialize()
+{
+	if ( IsRecording() ) StopRecording();
+	if ( IsReplaying() ) StopReplay();
+
+	Super::Deinitialize();
+}
+
+bool UInputReplaySubsystem::IsTickable() const
+{
+	return Mode != EMode::None;
+}
+
+TStatId UInputReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT( UInputReplaySubsystem, STATGROUP_Tickables );
+}
+
+ACapstoneCharacter* UInputReplaySubsystem::GetLocalCharacter() const
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	return PlayerController && PlayerController->IsLocalController() ? Cast<ACapstoneCharacter>( PlayerController->GetPawn() ) : nullptr;
+}
+
+void UInputReplaySubsystem::Record( const ACapstoneCharacter* Character, const EReplayInput Input, const FVector2D& Value )
+{
+	UInputReplaySubsystem* Replay = GetReplaySubsystem( Character->GetWorld() );
+	if ( !Replay || !Replay->IsRecording() || Replay->RecordedCharacter != Character ) return;
+
+	FReplayEvent& Event = Replay->CurrentEvents.AddDefaulted_GetRef();
+	Event.Input = Input;
+	Event.Value = Value;
+}
+
+void UInputReplaySubsystem::StartRecording( const FString& Path )
+{
+	if ( Mode != EMode::None ) return;
+
+	TimelinePath = Path.IsEmpty() ? FPaths::ProfilingDir() / TEXT( "InputReplays" ) / FString::Printf( TEXT( "Input-%s.bin" ), *FDateTime::Now().ToString() ) : Path;
+	MapName = GetWorld()->GetMapName();
+	Frames.Reset();
+	CurrentEvents.Reset();
+	RecordedCharacter.Reset();
+	Mode = EMode::Recording;
+
+	UE_LOG( LogInputReplay, Log, TEXT( "Recording input to %s" ), *TimelinePath );
+}
+
+void UInputReplaySubsystem::StopRecording()
+{
+	if ( !IsRecording() ) return;
+	Mode = EMode::None;
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer( Bytes );
+	SerializeTimeline( Writer );
+
+	if ( FFileHelper::SaveArrayToFile( Bytes, *TimelinePath ) )
+	{
+		UE_LOG( LogInputReplay, Log, TEXT( "Wrote %d frames of input (%d bytes) to %s" ), Frames.Num(), Bytes.Num(), *TimelinePath );
+	}
+	else
+	{
+		UE_LOG( LogInputReplay, Error, TEXT( "Could not write %s" ), *TimelinePath );
+	}
+
+	Frames.Empty();
+}
+
+bool UInputReplaySubsystem::StartReplay( const FString& Path )
+{
+	if ( Mode != EMode::None ) return false;
+
+	TArray<uint8> Bytes;
+	if ( !FFileHelper::LoadFileToArray( Bytes, *Path ) )
+	{
+		UE_LOG( LogInputReplay, Error, TEXT( "Could not read %s" ), *Path );
+		return false;
+	}
+
+	// Strings in the header are bounded by the file too
+	FMemoryReader Reader( Bytes );
+	Reader.ArMaxSerializeSize = Bytes.Num();
+	SerializeTimeline( Reader );
+	if ( Reader.IsError() )
+	{
+		UE_LOG( LogInputReplay, Error, TEXT( "%s is not an input timeline of this version" ), *Path );
+		Frames.Empty();
+		return false;
+	}
+
+	if ( MapName != GetWorld()->GetMapName() )
+	{
+		UE_LOG( LogInputReplay, Warning, TEXT( "%s was recorded on %s, replaying on %s" ), *Path, *MapName, *GetWorld()->GetMapName() );
+	}
+
+	TimelinePath = Path;
+	ReplayFrame = INDEX_NONE;
+	Mode = EMode::Replaying;
+
+	UE_LOG( LogInputReplay, Log, TEXT( "Replaying %d frames of input from %s" ), Frames.Num(), *Path );
+	return true;
+}
+
+void UInputReplaySubsystem::StopReplay()
+{
+	if ( !IsReplaying() ) return;
+	Mode = EMode::None;
+
+	if ( ReplayFrame != INDEX_NONE && bFixedTimeStep )
+	{
+		FApp::SetUseFixedTimeStep( bWasUsingFixedTimeStep );
+		FApp::SetFixedDeltaTime( PreviousFixedDeltaTime );
+	}
+
+	UE_LOG( LogInputReplay, Log, TEXT( "Finished replaying %s" ), *TimelinePath );
+	Frames.Empty();
+}
+
+void UInputReplaySubsystem::SerializeTimeline( FArchive& Ar )
+{
+	// Delta time and a packed event count
+	constexpr int64 MinFrameBytes = sizeof( float ) + 1;
+
+	uint32 Magic = TimelineMagic;
+	uint8 Version = TimelineVersion;
+	Ar << Magic << Version;
+	if ( Magic != TimelineMagic || Version != TimelineVersion )
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << MapName << StartLocation << StartControlRotation;
+
+	int32 NumFrames = Frames.Num();
+	Ar << NumFrames;
+	if ( Ar.IsLoading() )
+	{
+		// A frame takes at least its delta time and event count, a truncated or corrupt file must not size the array
+		if ( NumFrames < 0 || NumFrames > ( Ar.TotalSize() - Ar.Tell() ) / MinFrameBytes )
+		{
+			Ar.SetError();
+			return;
+		}
+		Frames.SetNum( NumFrames );
+	}
+
+	// Most frames carry one or two events, so counts and slots are packed and axis values kept at float precision
+	for ( FReplayFrame& Frame : Frames )
+	{
+		Ar << Frame.DeltaTime;
+
+		uint32 NumEvents = Frame.Events.Num();
+		Ar.SerializeIntPacked( NumEvents );
+		if ( Ar.IsLoading() )
+		{
+			// Every event takes at least its input byte
+			if ( Ar.IsError() || NumEvents > static_cast<uint64>( FMath::Max<int64>( Ar.TotalSize() - Ar.Tell(), 0 ) ) )
+			{
+				Ar.SetError();
+				return;
+			}
+			Frame.Events.SetNum( NumEvents );
+		}
+
+		for ( FReplayEvent& Event : Frame.Events )
+		{
+			uint8 Input = static_cast<uint8>( Event.Input );
+			Ar << Input;
+			Event.Input = static_cast<EReplayInput>( Input );
+
+			if ( Event.Input == EReplayInput::Move || Event.Input == EReplayInput::Look )
+			{
+				float X = Event.Value.X;
+				float Y = Event.Value.Y;
+				Ar << X << Y;
+				Event.Value = FVector2D( X, Y );
+			}
+			else if ( Event.Input == EReplayInput::Equip )
+			{
+				uint32 Slot = static_cast<uint32>( Event.Value.X );
+				Ar.SerializeIntPacked( Slot );
+				Event.Value = FVector2D( Slot, 0.0f );
+			}
+		}
+
+		if ( Ar.IsError() ) return;
+	}
+}
+
+void UInputReplaySubsystem::Tick( float DeltaTime )
+{
+	if ( IsRecording() ) TickRecording( DeltaTime );
+	else if ( IsReplaying() ) TickReplay();
+}
+
+void UInputReplaySubsystem::TickRecording( float DeltaTime )
+{
+	// The timeline starts on the first frame the local character exists
+	if ( !RecordedCharacter.IsValid() )
+	{
+		ACapstoneCharacter* Character = GetLocalCharacter();
+		if ( !Character ) return;
+
+		RecordedCharacter = Character;
+		StartLocation = Character->GetActorLocation();
+		StartControlRotation = Character->GetControlRotation();
+		CurrentEvents.Reset();
+		return;
+	}
+
+	FReplayFrame& Frame = Frames.AddDefaulted_GetRef();
+	Frame.DeltaTime = DeltaTime;
+	Frame.Events = MoveTemp( CurrentEvents );
+	CurrentEvents.Reset();
+}
+
+void UInputReplaySubsystem::TickReplay()
+{
+	ACapstoneCharacter* Character = GetLocalCharacter();
+	if ( !Character ) return;
+
+	if ( ReplayFrame == INDEX_NONE )
+	{
+		// Start from where the recording did. Clients cannot move their pawn on their own, the server decides.
+		if ( Character->HasAuthority() ) Character->TeleportTo( StartLocation, Character->GetActorRotation(), false, true );
+		Character->GetController()->SetControlRotation( StartControlRotation );
+
+		bWasUsingFixedTimeStep = FApp::UseFixedTimeStep();
+		PreviousFixedDeltaTime = FApp::GetFixedDeltaTime();
+		if ( bFixedTimeStep ) FApp::SetUseFixedTimeStep( true );
+
+		ReplayFrame = 0;
+	}
+
+	if ( !Frames.IsValidIndex( ReplayFrame ) )
+	{
+		StopReplay();
+		return;
+	}
+
+	// This runs at the end of a frame: the next frame gets the recorded length, and its input is queued now so it is
+	// consumed by the same ticks that consumed it during recording
+	const FReplayFrame& Frame = Frames[ReplayFrame++];
+	if ( bFixedTimeStep ) FApp::SetFixedDeltaTime( Frame.DeltaTime );
+
+	for ( const FReplayEvent& Event : Frame.Events ) Dispatch( Character, Event );
+}
+
+void UInputReplaySubsystem::Dispatch( ACapstoneCharacter* Character, const FReplayEvent& Event ) const
+{
+	switch ( Event.Input )
+	{
+	case EReplayInput::Move:
+		Character->Move( FInputActionValue( Event.Value ) );
+		break;
+	case EReplayInput::Look:
+		Character->Look( FInputActionValue( Event.Value ) );
+		break;
+	case EReplayInput::JumpStart:
+		Character->Jump();
+		break;
+	case EReplayInput::JumpStop:
+		Character->StopJumping();
+		break;
+	case EReplayInput::FireStart:
+		Character->StartFire( FInputActionValue() );
+		break;
+	case EReplayInput::FireStop:
+		Character->StopFire();
+		break;
+	case EReplayInput::SwitchCamera:
+		Character->SwitchCameras();
+		break;
+	case EReplayInput::Equip:
+		Character->Equip( static_cast<int32>( Event.Value.X ) );
+		break;
+	}
+}
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InputReplaySubsystem.generated.h"
+
+class ACapstoneCharacter;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogInputReplay, Log, All );
+
+// One input handler call of ACapstoneCharacter, as recorded in an input timeline
+enum class EReplayInput : uint8
+{
+	Move,			// Value is the move axis
+	Look,			// Value is the look axis
+	JumpStart,
+	JumpStop,
+	FireStart,
+	FireStop,
+	SwitchCamera,
+	Equip,			// Value.X is the slot
+};
+
+/**
+ * Records the input handlers the local ACapstoneCharacter runs every frame into a compact binary timeline, and feeds a
+ * timeline back through the same handlers to reproduce a session frame by frame, e.g. under Unreal Insights:
+ *   Capstone /Game/Maps/NetworkTesting -game -nullrhi -InputReplay=<file> -trace=cpu,frame
+ * Record with -InputRecord[=<file>] or the console commands Capstone.InputRecord / Capstone.InputRecordStop.
+ * Replays run on a fixed time step using the recorded frame times unless -InputReplayRealTime is given.
+ * The replaying machine must own the pawn's movement, so replay standalone or as a client of a server that plays along.
+ */
+UCLASS()
+class CAPSTONE_API UInputReplaySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Adds a handler call of Character to the timeline being recorded. Does nothing unless recording.*/
+	static void Record( const ACapstoneCharacter* Character, const EReplayInput Input, const FVector2D& Value = FVector2D::ZeroVector );
+
+	/** Starts recording the local character into Path, Saved/Profiling/InputReplays if empty.*/
+	void StartRecording( const FString& Path );
+
+	/** Writes the timeline recorded so far and stops recording.*/
+	void StopRecording();
+
+	/** Loads the timeline at Path and starts replaying it as soon as the local character exists.*/
+	bool StartReplay( const FString& Path );
+
+	virtual void Initialize( FSubsystemCollectionBase& Collection ) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick( float DeltaTime ) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	FORCEINLINE bool IsRecording() const { return Mode == EMode::Recording; }
+	FORCEINLINE bool IsReplaying() const { return Mode == EMode::Replaying; }
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	enum class EMode : uint8
+	{
+		None,
+		Recording,
+		Replaying,
+	};
+
+	struct FReplayEvent
+	{
+		EReplayInput Input = EReplayInput::Move;
+		FVector2D Value = FVector2D::ZeroVector;
+	};
+
+	struct FReplayFrame
+	{
+		float DeltaTime = 0.0f;
+		TArray<FReplayEvent> Events;
+	};
+
+	/** Serializes the header and every frame. Frames are stored as a delta time and the events handled in them.*/
+	void SerializeTimeline( FArchive& Ar );
+
+	ACapstoneCharacter* GetLocalCharacter() const;
+
+	void TickRecording( float DeltaTime );
+	void TickReplay();
+
+	/** Calls the handler an event was recorded from.*/
+	void Dispatch( ACapstoneCharacter* Character, const FReplayEvent& Event ) const;
+
+	void StopReplay();
+
+	EMode Mode = EMode::None;
+	FString TimelinePath;
+
+	// Timeline header, the pawn's start state so a replay begins where the recording did
+	FString MapName;
+	FVector StartLocation = FVector::ZeroVector;
+	FRotator StartControlRotation = FRotator::ZeroRotator;
+
+	TArray<FReplayFrame> Frames;
+
+	// Events of the frame currently being recorded
+	TArray<FReplayEvent> CurrentEvents;
+
+	TWeakObjectPtr<ACapstoneCharacter> RecordedCharacter;
+
+	int32 ReplayFrame = INDEX_NONE;
+	bool bFixedTimeStep = true;
+	bool bWasUsingFixedTimeStep = false;
+	double PreviousFixedDeltaTime = 0.0;
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LagCompensationSubsystem.h"
+#include "CapstoneCharacter.h"
+#include "PoseHistory.h"
+
+#include "Components/CapsuleComponent.h"
+
+bool ULagCompensationSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void ULagCompensationSubsystem::RegisterCharacter( ACapstoneCharacter* Character )
+{
+	Characters.AddUnique( Character );
+}
+
+void ULagCompensationSubsystem::UnregisterCharacter( ACapstoneCharacter* Character )
+{
+	Characters.RemoveSwap( Character );
+}
+
+float ULagCompensationSubsystem::ClampRewind( const float RewindSeconds ) const
+{
+	return FMath::Clamp( RewindSeconds, 0.0f, MaxRewindSeconds );
+}
+
+bool ULagCompensationSubsystem::SweepRewound( const FVector& Start, const FVector& End, const float Radius, const float ServerTime, const AActor* IgnoreActor, FHitResult& OutHit ) const
+{
+	static const FName HeadBoneName( "head" );
+
+	const float SweepLength = FVector::Dist( Start, End );
+	float BestDistanceSquared = MAX_flt;
+
+	for ( ACapstoneCharacter* Character : Characters )
+	{
+		if ( !IsValid( Character ) || Character == IgnoreActor || Character->IsDead() ) continue;
+
+		FPoseSnapshot Pose;
+		if ( !Character->GetPoseHistory().Sample( ServerTime, Pose ) ) continue;
+
+		UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		FVector PointOnSweep;
+		FVector PointOnTarget;
+		float TargetRadius;
+		FName BoneName = NAME_None;
+
+		// Test the head first so a shot clipping both hitboxes counts as a headshot
+		PointOnSweep = FMath::ClosestPointOnSegment( Pose.HeadLocation, Start, End );
+		if ( FVector::DistSquared( PointOnSweep, Pose.HeadLocation ) <= FMath::Square( HeadRadius + Radius ) )
+		{
+			PointOnTarget = Pose.HeadLocation;
+			TargetRadius = HeadRadius;
+			BoneName = HeadBoneName;
+		}
+		else
+		{
+			const FVector Axis = Pose.Rotation.GetUpVector() * Capsule->GetScaledCapsuleHalfHeight_WithoutHemisphere();
+			FMath::SegmentDistToSegmentSafe( Start, End, Pose.Location - Axis, Pose.Location + Axis, PointOnSweep, PointOnTarget );
+
+			TargetRadius = Capsule->GetScaledCapsuleRadius();
+			if ( FVector::DistSquared( PointOnSweep, PointOnTarget ) > FMath::Square( TargetRadius + Radius ) ) continue;
+		}
+
+		const float DistanceSquared = FVector::DistSquared( Start, PointOnSweep );
+		if ( DistanceSquared >= BestDistanceSquared ) continue;
+		BestDistanceSquared = DistanceSquared;
+
+		const FVector Normal = ( PointOnSweep - PointOnTarget ).GetSafeNormal();
+		OutHit = FHitResult( Character, Capsule, PointOnSweep, Normal );
+		OutHit.bBlockingHit = true;
+		OutHit.TraceStart = Start;
+		OutHit.TraceEnd = End;
+		OutHit.ImpactPoint = PointOnTarget + Normal * TargetRadius;
+		OutHit.ImpactNormal = Normal;
+		OutHit.BoneName = BoneName;
+		OutHit.Distance = FMath::Sqrt( DistanceSquared );
+		OutHit.Time = SweepLength > 0.0f ? OutHit.Distance / SweepLength : 0.0f;
+	}
+
+	return BestDistanceSquared < MAX_flt;
+}
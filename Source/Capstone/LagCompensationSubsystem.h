@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LagCompensationSubsystem.generated.h"
+
+class ACapstoneCharacter;
+
+/**
+ * Server-side hit validation against rewound character hitboxes. Characters record their pose every server tick
+ * into an FPoseHistory, shots are then tested against the poses the shooter saw when it fired instead of the
+ * current ones. Tests are analytic (capsule and head sphere) and never touch the physics scene.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API ULagCompensationSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterCharacter( ACapstoneCharacter* Character );
+	void UnregisterCharacter( ACapstoneCharacter* Character );
+
+	FORCEINLINE const TArray<ACapstoneCharacter*>& GetCharacters() const { return Characters; }
+
+	/** Clamps how far back a shot may rewind so a lagging client cannot hit targets that have long moved on.*/
+	float ClampRewind( const float RewindSeconds ) const;
+
+	FORCEINLINE float GetMaxRewindSeconds() const { return MaxRewindSeconds; }
+
+	/**
+	 * Sweeps a sphere of Radius from Start to End against every registered character as it was at ServerTime.
+	 * Returns the first hit along the sweep. IgnoreActor is usually the shooter.
+	 */
+	bool SweepRewound( const FVector& Start, const FVector& End, const float Radius, const float ServerTime, const AActor* IgnoreActor, FHitResult& OutHit ) const;
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	/** Longest rewind the server allows, in seconds.*/
+	UPROPERTY( config )
+	float MaxRewindSeconds = 0.4f;
+
+	/** Radius of the head hitbox centered on the head bone.*/
+	UPROPERTY( config )
+	float HeadRadius = 15.0f;
+
+	UPROPERTY()
+	TArray<ACapstoneCharacter*> Characters;
+};
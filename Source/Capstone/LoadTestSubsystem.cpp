@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LoadTestSubsystem.h"
+#include "CapstoneCharacter.h"
+
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/FileManager.h"
+#include "InputActionValue.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY( LogLoadTest );
+
+bool ULoadTestSubsystem::ShouldCreateSubsystem( UObject* Outer ) const
+{
+	return ( FParse::Param( FCommandLine::Get(), TEXT( "LoadTest" ) ) || FParse::Param( FCommandLine::Get(), TEXT( "LoadTestBot" ) ) )
+		&& Super::ShouldCreateSubsystem( Outer );
+}
+
+bool ULoadTestSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game;
+}
+
+void ULoadTestSubsystem::Initialize( FSubsystemCollectionBase& Collection )
+{
+	Super::Initialize( Collection );
+
+	bServer = FParse::Param( FCommandLine::Get(), TEXT( "LoadTest" ) );
+	TestStartTime = FPlatformTime::Seconds();
+
+	int32 Seed = FPlatformProcess::GetCurrentProcessId();
+	FParse::Value( FCommandLine::Get(), TEXT( "LoadTestSeed=" ), Seed );
+	BotRandom.Initialize( Seed );
+}
+
+void ULoadTestSubsystem::Deinitialize()
+{
+	if ( CsvWriter )
+	{
+		CsvWriter->Close();
+		CsvWriter.Reset();
+	}
+
+	Super::Deinitialize();
+}
+
+TStatId ULoadTestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT( ULoadTestSubsystem, STATGROUP_Tickables );
+}
+
+void ULoadTestSubsystem::RecordRPC( const AActor* Actor )
+{
+	ULoadTestSubsystem* LoadTest = Actor->GetWorld()->GetSubsystem<ULoadTestSubsystem>();
+	if ( !LoadTest || !LoadTest->bServer ) return;
+
+	++LoadTest->RPCCounts.FindOrAdd( Actor->GetNetConnection() );
+}
+
+void ULoadTestSubsystem::Tick( float DeltaTime )
+{
+	if ( bServer && GetWorld()->GetNetMode() != NM_Client ) TickServer( DeltaTime );
+	else if ( !bServer && GetWorld()->GetNetMode() == NM_Client ) TickBot( DeltaTime );
+}
+
+void ULoadTestSubsystem::TickServer( float DeltaTime )
+{
+	// Idle time is what the server slept to hold its max tick rate, the rest is actual work
+	const float WorkTime = FMath::Max( DeltaTime - static_cast<float>( FApp::GetIdleTime() ), 0.0f );
+
+	FrameTimeSum += DeltaTime;
+	WorkTimeSum += WorkTime;
+	MaxWorkTime = FMath::Max( MaxWorkTime, WorkTime );
+	++NumFrames;
+
+	SampleElapsed += DeltaTime;
+	if ( SampleElapsed < SampleInterval ) return;
+
+	WriteSample();
+
+	SampleElapsed = 0.0f;
+	FrameTimeSum = 0.0f;
+	WorkTimeSum = 0.0f;
+	MaxWorkTime = 0.0f;
+	NumFrames = 0;
+	RPCCounts.Reset();
+}
+
+void ULoadTestSubsystem::OpenCsv()
+{
+	FString Path;
+	if ( !FParse::Value( FCommandLine::Get(), TEXT( "LoadTestCsv=" ), Path ) )
+	{
+		Path = FPaths::ProfilingDir() / TEXT( "LoadTest" ) / FString::Printf( TEXT( "Server-%s.csv" ), *FDateTime::Now().ToString() );
+	}
+
+	CsvWriter.Reset( IFileManager::Get().CreateFileWriter( *Path ) );
+	if ( !CsvWriter )
+	{
+		UE_LOG( LogLoadTest, Error, TEXT( "Could not open %s for writing" ), *Path );
+		return;
+	}
+
+	UE_LOG( LogLoadTest, Log, TEXT( "Writing load test samples to %s" ), *Path );
+	WriteLine( TEXT( "Time,FrameMs,WorkMs,MaxWorkMs,Connections,Connection,Address,InBytesPerSec,OutBytesPerSec,RPCsPerSec,PingMs" ) );
+}
+
+void ULoadTestSubsystem::WriteSample()
+{
+	if ( !CsvWriter ) OpenCsv();
+	if ( !CsvWriter || NumFrames == 0 ) return;
+
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	const int32 NumConnections = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+
+	const FString FrameColumns = FString::Printf( TEXT( "%.2f,%.3f,%.3f,%.3f,%d" ),
+		FPlatformTime::Seconds() - TestStartTime,
+		FrameTimeSum / NumFrames * 1000.0f,
+		WorkTimeSum / NumFrames * 1000.0f,
+		MaxWorkTime * 1000.0f,
+		NumConnections );
+
+	// One row per connection so bandwidth can be plotted per client, a lone row while nobody is connected
+	if ( NumConnections == 0 )
+	{
+		WriteLine( FrameColumns + TEXT( ",,,0,0,0,0" ) );
+	}
+
+	for ( int32 Index = 0; Index < NumConnections; ++Index )
+	{
+		const UNetConnection* Connection = NetDriver->ClientConnections[Index];
+		if ( !Connection ) continue;
+
+		const int32* RPCs = RPCCounts.Find( Connection );
+		const APlayerController* PlayerController = Connection->PlayerController;
+		const APlayerState* PlayerState = PlayerController ? PlayerController->PlayerState : nullptr;
+
+		WriteLine( FString::Printf( TEXT( "%s,%d,%s,%d,%d,%.1f,%.1f" ),
+			*FrameColumns,
+			Index,
+			*Connection->LowLevelGetRemoteAddress(),
+			Connection->InBytesPerSecond,
+			Connection->OutBytesPerSecond,
+			( RPCs ? *RPCs : 0 ) / SampleElapsed,
+			PlayerState ? PlayerState->GetPingInMilliseconds() : 0.0f ) );
+	}
+
+	CsvWriter->Flush();
+}
+
+void ULoadTestSubsystem::WriteLine( const FString& Line )
+{
+	const FTCHARToUTF8 Utf8( *( Line + LINE_TERMINATOR ) );
+	CsvWriter->Serialize( const_cast<ANSICHAR*>( Utf8.Get() ), Utf8.Length() );
+}
+
+void ULoadTestSubsystem::TickBot( float DeltaTime )
+{
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	ACapstoneCharacter* Character = PlayerController ? Cast<ACapstoneCharacter>( PlayerController->GetPawn() ) : nullptr;
+	if ( !Character ) return;
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	if ( Now >= NextDecisionTime )
+	{
+		NextDecisionTime = Now + BotDecisionInterval;
+
+		BotMoveDirection = FVector( BotRandom.FRandRange( -1.0f, 1.0f ), BotRandom.FRandRange( -1.0f, 1.0f ), 0.0f ).GetSafeNormal();
+		BotTurnRate = BotRandom.FRandRange( -BotMaxTurnRate, BotMaxTurnRate );
+
+		const bool bWantsFire = BotRandom.FRand() < BotFireChance;
+		if ( bWantsFire && !bBotFiring ) Character->StartFire( FInputActionValue() );
+		else if ( !bWantsFire && bBotFiring ) Character->StopFire();
+		bBotFiring = bWantsFire;
+	}
+
+	if ( Now >= NextSwitchTime && Character->Weapons.Num() > 1 )
+	{
+		NextSwitchTime = Now + BotSwitchInterval;
+		Character->Equip( ( Character->CurrentIndex + 1 ) % Character->Weapons.Num() );
+	}
+
+	Character->AddMovementInput( BotMoveDirection );
+	Character->AddControllerYawInput( BotTurnRate * DeltaTime );
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LoadTestSubsystem.generated.h"
+
+class UNetConnection;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogLoadTest, Log, All );
+
+/**
+ * Load test harness, only created when the process runs with -LoadTest (server) or -LoadTestBot (client).
+ * On the server it samples frame time, per-connection bandwidth and received RPCs every SampleInterval seconds and
+ * appends them to a CSV file (-LoadTestCsv=<path>, Saved/Profiling/LoadTest by default).
+ * On a client it drives the local ACapstoneCharacter like a player would: moving, looking, firing and switching
+ * weapons on a schedule seeded by -LoadTestSeed=<n> so runs are repeatable. Scripts/LoadTest.sh starts both.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API ULoadTestSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem( UObject* Outer ) const override;
+	virtual void Initialize( FSubsystemCollectionBase& Collection ) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick( float DeltaTime ) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Counts a server RPC received on Actor's connection. Does nothing unless a load test is running.*/
+	static void RecordRPC( const AActor* Actor );
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	void TickServer( float DeltaTime );
+	void TickBot( float DeltaTime );
+
+	void OpenCsv();
+	void WriteSample();
+	void WriteLine( const FString& Line );
+
+	/** Seconds between two CSV samples.*/
+	UPROPERTY( config )
+	float SampleInterval = 1.0f;
+
+	/** Seconds a bot keeps walking and turning the same way before it picks a new direction.*/
+	UPROPERTY( config )
+	float BotDecisionInterval = 2.0f;
+
+	/** Fastest a bot turns, in degrees per second.*/
+	UPROPERTY( config )
+	float BotMaxTurnRate = 120.0f;
+
+	/** Chance a bot holds the trigger for the next decision interval.*/
+	UPROPERTY( config )
+	float BotFireChance = 0.5f;
+
+	/** Seconds between two weapon switches of a bot.*/
+	UPROPERTY( config )
+	float BotSwitchInterval = 7.0f;
+
+	bool bServer = false;
+
+	// Server sampling
+	TUniquePtr<FArchive> CsvWriter;
+	TMap<TObjectKey<UNetConnection>, int32> RPCCounts;
+	double TestStartTime = 0.0;
+	float SampleElapsed = 0.0f;
+	float FrameTimeSum = 0.0f;
+	float WorkTimeSum = 0.0f;
+	float MaxWorkTime = 0.0f;
+	int32 NumFrames = 0;
+
+	// Bot state
+	FRandomStream BotRandom;
+	FVector BotMoveDirection = FVector::ForwardVector;
+	float BotTurnRate = 0.0f;
+	float NextDecisionTime = 0.0f;
+	float NextSwitchTime = 0.0f;
+	bool bBotFiring = false;
+};
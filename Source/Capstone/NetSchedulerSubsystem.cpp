@@ -0,0 +1,238 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "NetSchedulerSubsystem.h"
+#include "CapstoneCharacter.h"
+#include "CapstoneReplicationGraph.h"
+#include "NetworkProjectile.h"
+#include "Weapon.h"
+#include "CapstoneNetStats.h"
+
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+
+bool UNetSchedulerSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+bool UNetSchedulerSubsystem::IsTickable() const
+{
+	// Standalone games and clients have nothing to send
+	const ENetMode NetMode = GetWorld() ? GetWorld()->GetNetMode() : NM_Standalone;
+	return NetMode == NM_DedicatedServer || NetMode == NM_ListenServer;
+}
+
+TStatId UNetSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT( UNetSchedulerSubsystem, STATGROUP_Tickables );
+}
+
+void UNetSchedulerSubsystem::RegisterCharacter( ACapstoneCharacter* Character )
+{
+	Characters.AddUnique( Character );
+}
+
+void UNetSchedulerSubsystem::UnregisterCharacter( ACapstoneCharacter* Character )
+{
+	Characters.RemoveSwap( Character );
+}
+
+void UNetSchedulerSubsystem::RegisterProjectile( ANetworkProjectile* Projectile )
+{
+	Projectiles.AddUnique( Projectile );
+}
+
+void UNetSchedulerSubsystem::UnregisterProjectile( ANetworkProjectile* Projectile )
+{
+	Projectiles.RemoveSwap( Projectile );
+}
+
+void UNetSchedulerSubsystem::RegisterWeapon( AWeapon* Weapon )
+{
+	WeaponActiveTimes.Add( Weapon, GetWorld()->GetTimeSeconds() );
+}
+
+void UNetSchedulerSubsystem::UnregisterWeapon( AWeapon* Weapon )
+{
+	WeaponActiveTimes.Remove( Weapon );
+}
+
+void UNetSchedulerSubsystem::WakeWeapon( AWeapon* Weapon )
+{
+	if ( !Weapon || !Weapon->HasAuthority() ) return;
+
+	float* ActiveTime = WeaponActiveTimes.Find( Weapon );
+	if ( !ActiveTime ) return;
+
+	*ActiveTime = GetWorld()->GetTimeSeconds();
+
+	// The weapon stays dormant, flushing sends the change without reopening its channel for good
+	if ( Weapon->NetDormancy > DORM_Awake ) Weapon->FlushNetDormancy();
+}
+
+void UNetSchedulerSubsystem::HolsterWeapon( AWeapon* Weapon )
+{
+	if ( !Weapon || !Weapon->HasAuthority() || !WeaponActiveTimes.Contains( Weapon ) ) return;
+
+	Weapon->SetNetDormancy( DORM_DormantAll );
+}
+
+void UNetSchedulerSubsystem::EquipWeapon( AWeapon* Weapon )
+{
+	if ( !Weapon || !Weapon->HasAuthority() ) return;
+
+	float* ActiveTime = WeaponActiveTimes.Find( Weapon );
+	if ( !ActiveTime ) return;
+
+	*ActiveTime = GetWorld()->GetTimeSeconds();
+	Weapon->SetNetDormancy( DORM_Awake );
+}
+
+void UNetSchedulerSubsystem::Tick( float DeltaTime )
+{
+	TimeUntilUpdate -= DeltaTime;
+	if ( TimeUntilUpdate > 0.0f ) return;
+
+	TimeUntilUpdate = UpdateInterval;
+
+	SCOPE_CYCLE_COUNTER( STAT_NetSchedulerUpdate );
+
+	Viewpoints.Reset();
+	for ( FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It )
+	{
+		const APlayerController* PlayerController = It->Get();
+		if ( !PlayerController ) continue;
+
+		FRotator ViewRotation;
+		FNetViewpoint& Viewpoint = Viewpoints.AddDefaulted_GetRef();
+		Viewpoint.Controller = PlayerController;
+		PlayerController->GetPlayerViewPoint( Viewpoint.Location, ViewRotation );
+	}
+
+	UpdateCharacters();
+	UpdateProjectiles();
+	UpdateWeapons();
+}
+
+void UNetSchedulerSubsystem::UpdateCharacters()
+{
+	for ( int32 Index = Characters.Num() - 1; Index >= 0; --Index )
+	{
+		ACapstoneCharacter* Character = Characters[Index];
+		if ( !IsValid( Character ) )
+		{
+			Characters.RemoveAtSwap( Index, 1, false );
+			continue;
+		}
+
+		if ( Character->IsDead() )
+		{
+			ApplyRate( Character, DeadCharacterFrequency, FarCharacterPriority );
+			continue;
+		}
+
+		// Distance to the closest player other than the one controlling the character
+		float ClosestDistanceSquared = UE_BIG_NUMBER;
+		const FVector Location = Character->GetActorLocation();
+		for ( const FNetViewpoint& Viewpoint : Viewpoints )
+		{
+			if ( Viewpoint.Controller == Character->GetController() ) continue;
+			ClosestDistanceSquared = FMath::Min( ClosestDistanceSquared, FVector::DistSquared( Viewpoint.Location, Location ) );
+		}
+
+		const float Alpha = FMath::GetRangePct( NearCharacterDistance, FarCharacterDistance, FMath::Sqrt( ClosestDistanceSquared ) );
+		float Frequency = FMath::Lerp( NearCharacterFrequency, FarCharacterFrequency, FMath::Clamp( Alpha, 0.0f, 1.0f ) );
+		float Priority = FMath::Lerp( NearCharacterPriority, FarCharacterPriority, FMath::Clamp( Alpha, 0.0f, 1.0f ) );
+
+		// Whoever is being shot at, or shooting, needs to be accurate for everyone
+		if ( Character->IsInCombat( CombatWindow ) )
+		{
+			Frequency = FMath::Max( Frequency, CombatCharacterFrequency );
+			Priority = FMath::Max( Priority, NearCharacterPriority );
+		}
+
+		ApplyRate( Character, Frequency, Priority );
+	}
+}
+
+void UNetSchedulerSubsystem::UpdateProjectiles()
+{
+	for ( int32 Index = Projectiles.Num() - 1; Index >= 0; --Index )
+	{
+		ANetworkProjectile* Projectile = Projectiles[Index];
+		if ( !IsValid( Projectile ) )
+		{
+			Projectiles.RemoveAtSwap( Index, 1, false );
+			continue;
+		}
+
+		// Projectiles waiting in the pool are dormant already
+		if ( Projectile->NetDormancy > DORM_Awake ) continue;
+
+		const float Frequency = FMath::Clamp( Projectile->GetVelocity().Size() / ProjectileDistancePerUpdate, MinProjectileFrequency, MaxProjectileFrequency );
+		ApplyRate( Projectile, Frequency, ProjectilePriority );
+	}
+}
+
+void UNetSchedulerSubsystem::UpdateWeapons()
+{
+	const float IdleTime = GetWorld()->GetTimeSeconds() - WeaponIdleDelay;
+	int32 NumDormant = 0;
+
+	for ( auto It = WeaponActiveTimes.CreateIterator(); It; ++It )
+	{
+		AWeapon* Weapon = It->Key.Get();
+		if ( !Weapon )
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		// Holstered weapons are put to sleep when they are swapped out, this catches the ones spawned into a holster.
+		// The weapon in hand stays awake however long it goes unused
+		const bool bInHand = Weapon->CurrentOwner && Weapon->CurrentOwner->CurrentWeapon == Weapon;
+		const bool bHolstered = Weapon->CurrentOwner && !bInHand;
+		if ( Weapon->NetDormancy == DORM_Awake && !bInHand && ( bHolstered || It->Value <= IdleTime ) ) Weapon->SetNetDormancy( DORM_DormantAll );
+		if ( Weapon->NetDormancy > DORM_Awake ) NumDormant++;
+	}
+
+	SET_DWORD_STAT( STAT_NetScheduledActors, Characters.Num() + Projectiles.Num() + WeaponActiveTimes.Num() );
+	SET_DWORD_STAT( STAT_DormantWeapons, NumDormant );
+
+#if STATS
+	// Dormant weapons close their channel on every connection once their last update is acknowledged
+	int32 NumChannels = 0;
+	if ( const UNetDriver* NetDriver = GetWorld()->GetNetDriver() )
+	{
+		for ( UNetConnection* Connection : NetDriver->ClientConnections )
+		{
+			if ( !Connection ) continue;
+
+			for ( const TPair<TWeakObjectPtr<AWeapon>, float>& Pair : WeaponActiveTimes )
+			{
+				if ( Connection->FindActorChannelRef( Pair.Key ) ) NumChannels++;
+			}
+		}
+	}
+	SET_DWORD_STAT( STAT_WeaponChannels, NumChannels );
+#endif
+}
+
+void UNetSchedulerSubsystem::ApplyRate( AActor* Actor, const float Frequency, const float Priority ) const
+{
+	// Small changes are not worth touching the graph for
+	if ( FMath::IsNearlyEqual( Actor->NetUpdateFrequency, Frequency, 0.5f ) && FMath::IsNearlyEqual( Actor->NetPriority, Priority, 0.1f ) ) return;
+
+	Actor->NetUpdateFrequency = Frequency;
+	Actor->NetPriority = Priority;
+
+	if ( UCapstoneReplicationGraph* ReplicationGraph = GetReplicationGraph() ) ReplicationGraph->SetActorUpdateRate( Actor, Frequency, Priority );
+}
+
+UCapstoneReplicationGraph* UNetSchedulerSubsystem::GetReplicationGraph() const
+{
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	return NetDriver ? Cast<UCapstoneReplicationGraph>( NetDriver->GetReplicationDriver() ) : nullptr;
+}
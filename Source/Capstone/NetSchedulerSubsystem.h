@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NetSchedulerSubsystem.generated.h"
+
+class ACapstoneCharacter;
+class AWeapon;
+class ANetworkProjectile;
+class UCapstoneReplicationGraph;
+class APlayerController;
+
+/**
+ * Retunes NetUpdateFrequency and NetPriority of replicated gameplay actors at runtime, so that a saturated connection
+ * spends its budget on what is actually changing. Characters update less the further they are from every player and
+ * more while in combat, projectiles update in proportion to their speed, and unheld weapons whose state has not changed
+ * for WeaponIdleDelay go dormant; waking them flushes their dormancy so the change still goes out. Weapons their owner is
+ * not holding are dormant the whole time and only flushed, while the one in hand stays awake, so a loadout costs one
+ * open channel per player. Server only.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API UNetSchedulerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	void RegisterCharacter( ACapstoneCharacter* Character );
+	void UnregisterCharacter( ACapstoneCharacter* Character );
+
+	void RegisterProjectile( ANetworkProjectile* Projectile );
+	void UnregisterProjectile( ANetworkProjectile* Projectile );
+
+	/** Starts tracking Weapon for idle dormancy. It counts as active until WeaponIdleDelay passes without a wake.*/
+	void RegisterWeapon( AWeapon* Weapon );
+	void UnregisterWeapon( AWeapon* Weapon );
+
+	/** Tells the scheduler Weapon's replicated state just changed. A dormant weapon is flushed so the change is sent.*/
+	void WakeWeapon( AWeapon* Weapon );
+
+	/** Puts Weapon to sleep right away, its owner just put it away. It is only flushed on state changes from then on.*/
+	void HolsterWeapon( AWeapon* Weapon );
+
+	/** Wakes Weapon for good, its owner just took it in hand.*/
+	void EquipWeapon( AWeapon* Weapon );
+
+	virtual void Tick( float DeltaTime ) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	// Where a player looks from, a character is never far from its own player
+	struct FNetViewpoint
+	{
+		const APlayerController* Controller = nullptr;
+		FVector Location = FVector::ZeroVector;
+	};
+
+	void UpdateCharacters();
+	void UpdateProjectiles();
+	void UpdateWeapons();
+
+	/** Sets the rate on the actor and, since the graph keeps its own copy of it, on the replication graph.*/
+	void ApplyRate( AActor* Actor, float Frequency, float Priority ) const;
+
+	UCapstoneReplicationGraph* GetReplicationGraph() const;
+
+	/** Seconds between two passes over the registered actors.*/
+	UPROPERTY( config )
+	float UpdateInterval = 0.25f;
+
+	/** Characters closer than this to a player update at NearCharacterFrequency.*/
+	UPROPERTY( config )
+	float NearCharacterDistance = 1500.0f;
+
+	/** Characters further than this from every player update at FarCharacterFrequency.*/
+	UPROPERTY( config )
+	float FarCharacterDistance = 6000.0f;
+
+	UPROPERTY( config )
+	float NearCharacterFrequency = 30.0f;
+
+	UPROPERTY( config )
+	float FarCharacterFrequency = 8.0f;
+
+	UPROPERTY( config )
+	float NearCharacterPriority = 3.0f;
+
+	UPROPERTY( config )
+	float FarCharacterPriority = 1.0f;
+
+	/** Characters that dealt or took damage this recently update at least at CombatCharacterFrequency.*/
+	UPROPERTY( config )
+	float CombatWindow = 3.0f;
+
+	UPROPERTY( config )
+	float CombatCharacterFrequency = 45.0f;
+
+	/** Dead characters only replicate their ragdoll flag and health, they barely need updates.*/
+	UPROPERTY( config )
+	float DeadCharacterFrequency = 2.0f;
+
+	/** Distance a projectile may travel between two updates. Its frequency is its speed divided by this.*/
+	UPROPERTY( config )
+	float ProjectileDistancePerUpdate = 50.0f;
+
+	UPROPERTY( config )
+	float MinProjectileFrequency = 10.0f;
+
+	UPROPERTY( config )
+	float MaxProjectileFrequency = 60.0f;
+
+	UPROPERTY( config )
+	float ProjectilePriority = 2.5f;
+
+	/** Seconds without a state change before a weapon nobody holds goes dormant.*/
+	UPROPERTY( config )
+	float WeaponIdleDelay = 2.0f;
+
+	UPROPERTY()
+	TArray<ACapstoneCharacter*> Characters;
+
+	UPROPERTY()
+	TArray<ANetworkProjectile*> Projectiles;
+
+	// When each weapon last changed state
+	TMap<TWeakObjectPtr<AWeapon>, float> WeaponActiveTimes;
+
+	// Gathered once per pass
+	TArray<FNetViewpoint> Viewpoints;
+
+	float TimeUntilUpdate = 0.0f;
+};
@@ -2,6 +2,10 @@
 
 
 #include "NetworkProjectile.h"
+#include "ProjectilePoolSubsystem.h"
+#include "AggregatedTickSubsystem.h"
+#include "NetSchedulerSubsystem.h"
+#include "CapstoneStats.h"
 
 #include "Components/SphereComponent.h"
 #include "Components/StaticMeshComponent.h"
@@ -10,12 +14,14 @@
 #include "Particles/ParticleSystem.h"
 #include "Kismet/GameplayStatics.h"
 #include "UObject/ConstructorHelpers.h"
+#include "TimerManager.h"
+#include "Net/UnrealNetwork.h"
 
 // Sets default values
 ANetworkProjectile::ANetworkProjectile()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// Movement is driven by the ProjectileMovementComponent and homing by UAggregatedTickSubsystem, the actor itself never needs to tick.
+	PrimaryActorTick.bCanEverTick = false;
 
 	bReplicates = true;
 
@@ -66,28 +72,153 @@ ANetworkProjectile::ANetworkProjectile()
 void ANetworkProjectile::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	if ( HasAuthority() )
+	{
+		if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->RegisterProjectile( this );
+	}
+}
+
+void ANetworkProjectile::GetLifetimeReplicatedProps( TArray <FLifetimeProperty>& OutLifetimeProps ) const
+{
+	Super::GetLifetimeReplicatedProps( OutLifetimeProps );
+
+	DOREPLIFETIME_CONDITION( ANetworkProjectile, bPooled, COND_InitialOnly );
+}
+
+void ANetworkProjectile::ActivateFromPool( const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator )
+{
+	bPooled = true;
+	bPooledActive = true;
+
+	SetOwner( NewOwner );
+	SetInstigator( NewInstigator );
+	SetActorTransform( SpawnTransform, false, nullptr, ETeleportType::ResetPhysics );
+
+	SetActorHiddenInGame( false );
+	SetActorEnableCollision( true );
+
+	ProjectileMovementComponent->SetUpdatedComponent( SphereComponent );
+	ProjectileMovementComponent->Activate( true );
+	ProjectileMovementComponent->Velocity = SpawnTransform.GetRotation().GetForwardVector() * ProjectileMovementComponent->InitialSpeed;
+	ProjectileMovementComponent->UpdateComponentVelocity();
+
+	SetNetDormancy( DORM_Awake );
+	ForceNetUpdate();
+
+	if ( PooledLifeSpan > 0.0f )
+	{
+		GetWorldTimerManager().SetTimer( LifeSpanTimer, this, &ANetworkProjectile::ReturnToPool, PooledLifeSpan, false );
+	}
+}
+
+void ANetworkProjectile::DeactivateToPool()
+{
+	bPooled = true;
+	bPooledActive = false;
+
+	GetWorldTimerManager().ClearTimer( LifeSpanTimer );
+	StopHoming();
+
+	ProjectileMovementComponent->StopMovementImmediately();
+	ProjectileMovementComponent->Deactivate();
+
+	SetActorEnableCollision( false );
+	SetActorHiddenInGame( true );
+
+	SetOwner( nullptr );
+	SetInstigator( nullptr );
+
+	// Send the hidden state once, then stop considering the projectile for replication until it is reused
+	ForceNetUpdate();
+	SetNetDormancy( DORM_DormantAll );
+}
+
+void ANetworkProjectile::SetHomingTarget( USceneComponent* Target )
+{
+	HomingTarget = Target;
+	if ( !Target )
+	{
+		StopHoming();
+		return;
+	}
+
+	if ( UAggregatedTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UAggregatedTickSubsystem>() ) TickSubsystem->RegisterHoming( this );
+}
+
+bool ANetworkProjectile::UpdateHoming( const float DeltaTime )
+{
+	const USceneComponent* Target = HomingTarget.Get();
+	if ( !Target || ( bPooled && !bPooledActive ) ) return false;
+
+	const FVector ToTarget = ( Target->GetComponentLocation() - GetActorLocation() ).GetSafeNormal();
+	FVector& Velocity = ProjectileMovementComponent->Velocity;
+	Velocity = ( Velocity + ToTarget * HomingAcceleration * DeltaTime ).GetClampedToMaxSize( ProjectileMovementComponent->GetMaxSpeed() );
+	return true;
 }
 
-// Called every frame
-void ANetworkProjectile::Tick(float DeltaTime)
+void ANetworkProjectile::StopHoming()
 {
-	Super::Tick(DeltaTime);
+	HomingTarget.Reset();
 
+	if ( UAggregatedTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UAggregatedTickSubsystem>() ) TickSubsystem->UnregisterProjectile( this );
+}
+
+void ANetworkProjectile::ReturnToPool()
+{
+	if ( !bPooledActive ) return;
+
+	if ( UProjectilePoolSubsystem* Pool = GetWorld()->GetSubsystem<UProjectilePoolSubsystem>() )
+	{
+		Pool->ReleaseProjectile( this );
+	}
+	else
+	{
+		Destroy();
+	}
 }
 
 void ANetworkProjectile::Destroyed()
 {
-	FVector spawnLocation = GetActorLocation();
-	UGameplayStatics::SpawnEmitterAtLocation( this, ExplosionEffect, spawnLocation, FRotator::ZeroRotator, true, EPSCPoolMethod::AutoRelease );
+	// Pooled projectiles play their effect through Multicast_SpawnImpactEffect when they hit something
+	if ( !bPooled ) SpawnImpactEffect( GetActorLocation() );
+
+	StopHoming();
+	if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->UnregisterProjectile( this );
+
+	Super::Destroyed();
+}
+
+void ANetworkProjectile::Multicast_SpawnImpactEffect_Implementation( FVector_NetQuantize Location )
+{
+	SpawnImpactEffect( Location );
+}
+
+void ANetworkProjectile::SpawnImpactEffect( const FVector& Location ) const
+{
+	if ( GetNetMode() == NM_DedicatedServer ) return;
+
+	UGameplayStatics::SpawnEmitterAtLocation( this, ExplosionEffect, Location, FRotator::ZeroRotator, true, EPSCPoolMethod::AutoRelease );
 }
 
 void ANetworkProjectile::OnProjectileImpact( UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit )
 {
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_ProjectileImpact );
+
+	if ( bPooled && !bPooledActive ) return;
+
 	if ( OtherActor )
 	{
-		UGameplayStatics::ApplyPointDamage( OtherActor, Damage, NormalImpulse, Hit, GetInstigator()->Controller, this, DamageType );
+		UGameplayStatics::ApplyPointDamage( OtherActor, Damage, NormalImpulse, Hit, GetInstigatorController(), this, DamageType );
 	}
 
-	Destroy();
-}
\ No newline at end of file
+	if ( bPooled )
+	{
+		Multicast_SpawnImpactEffect( GetActorLocation() );
+		ReturnToPool();
+	}
+	else
+	{
+		Destroy();
+	}
+}
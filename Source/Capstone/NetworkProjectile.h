@@ -39,19 +39,62 @@ public:
     UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Damage" )
     float Damage;
 
+    // Seconds a pooled projectile flies without hitting anything before it is returned to the pool.
+    UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Projectile" )
+    float PooledLifeSpan = 5.0f;
+
+    // Called by UProjectilePoolSubsystem when the projectile is taken out of the pool. Resets all per-shot state.
+    virtual void ActivateFromPool( const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator );
+
+    // Called by UProjectilePoolSubsystem when the projectile is put back into the pool.
+    virtual void DeactivateToPool();
+
+    FORCEINLINE bool IsPooledActive() const { return bPooledActive; }
+
+    // Steers the projectile towards Target until it hits something or the target goes away.
+    UFUNCTION( BlueprintCallable, Category = "Projectile" )
+    void SetHomingTarget( USceneComponent* Target );
+
+    // Called by UAggregatedTickSubsystem every frame while homing. Returns false once there is nothing left to steer towards.
+    bool UpdateHoming( const float DeltaTime );
+
+    // Acceleration towards the homing target, in units per second squared.
+    UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Projectile" )
+    float HomingAcceleration = 4000.0f;
+
+    void GetLifetimeReplicatedProps( TArray<FLifetimeProperty>& OutLifetimeProps ) const override;
+
 protected:
     float size = 10.0f;
 
+    // True once the projectile is owned by UProjectilePoolSubsystem. Pooled projectiles are recycled instead of destroyed.
+    UPROPERTY( Replicated )
+    bool bPooled = false;
+
+    // True while a pooled projectile is in flight, false while it waits in the pool.
+    bool bPooledActive = false;
+
+    FTimerHandle LifeSpanTimer;
+
+    TWeakObjectPtr<USceneComponent> HomingTarget;
+
+    void StopHoming();
+
     virtual void Destroyed() override;
 
+    // Hands the projectile back to the pool, or destroys it if no pool exists for this world.
+    void ReturnToPool();
+
+    UFUNCTION( NetMulticast, Unreliable )
+    void Multicast_SpawnImpactEffect( FVector_NetQuantize Location );
+
+    void SpawnImpactEffect( const FVector& Location ) const;
+
+    // Hits whatever the projectile physically runs into, i.e. current poses. Lag compensated projectiles go through
+    // AProjectileBatchManager instead, which sweeps rewound hitboxes, see ACapstoneCharacter::bUseBatchedProjectiles.
     UFUNCTION( Category = "Projectile" )
     void OnProjectileImpact( UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit );
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
-
-public:	
-	// Called every frame
-	virtual void Tick(float DeltaTime) override;
-
 };
@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PoseHistory.h"
+
+void FPoseHistory::Record( const FPoseSnapshot& Snapshot )
+{
+	Snapshots[Head] = Snapshot;
+	Head = ( Head + 1 ) % Capacity;
+	Count = FMath::Min( Count + 1, Capacity );
+}
+
+bool FPoseHistory::Sample( const float Time, FPoseSnapshot& OutSnapshot ) const
+{
+	if ( Count == 0 ) return false;
+
+	const FPoseSnapshot& Newest = GetByAge( 0 );
+	if ( Time >= Newest.Time )
+	{
+		OutSnapshot = Newest;
+		return true;
+	}
+
+	const FPoseSnapshot& Oldest = GetByAge( Count - 1 );
+	if ( Time <= Oldest.Time )
+	{
+		OutSnapshot = Oldest;
+		return true;
+	}
+
+	// Times decrease with age, find the youngest snapshot recorded at or before Time
+	int32 Low = 1;
+	int32 High = Count - 1;
+	while ( Low < High )
+	{
+		const int32 Mid = ( Low + High ) / 2;
+		if ( GetByAge( Mid ).Time <= Time ) High = Mid;
+		else Low = Mid + 1;
+	}
+
+	const FPoseSnapshot& Before = GetByAge( Low );
+	const FPoseSnapshot& After = GetByAge( Low - 1 );
+	const float Alpha = ( Time - Before.Time ) / FMath::Max( After.Time - Before.Time, UE_KINDA_SMALL_NUMBER );
+
+	OutSnapshot.Time = Time;
+	OutSnapshot.Location = FMath::Lerp( Before.Location, After.Location, Alpha );
+	OutSnapshot.Rotation = FQuat::Slerp( Before.Rotation, After.Rotation, Alpha );
+	OutSnapshot.HeadLocation = FMath::Lerp( Before.HeadLocation, After.HeadLocation, Alpha );
+	return true;
+}
+
+void FPoseHistory::Reset()
+{
+	Head = 0;
+	Count = 0;
+}
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/StaticArray.h"
+
+// Hitbox state of a character at one server tick
+struct FPoseSnapshot
+{
+	float Time = 0.0f;
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector HeadLocation = FVector::ZeroVector;
+};
+
+/**
+ * Fixed-size ring buffer of the last Capacity hitbox snapshots of a character, used by the server to rewind targets
+ * to the time a client fired. Recording never allocates and sampling is a binary search over the ring.
+ */
+struct CAPSTONE_API FPoseHistory
+{
+	// About one second of history at 60 Hz
+	static constexpr int32 Capacity = 64;
+
+	void Record( const FPoseSnapshot& Snapshot );
+
+	/** Interpolates the snapshot at Time. Times outside the recorded range are clamped to the oldest or newest entry.*/
+	bool Sample( const float Time, FPoseSnapshot& OutSnapshot ) const;
+
+	void Reset();
+
+	FORCEINLINE int32 Num() const { return Count; }
+
+private:
+	// Age 0 is the newest snapshot, age Count - 1 the oldest
+	FORCEINLINE const FPoseSnapshot& GetByAge( const int32 Age ) const { return Snapshots[( Head - 1 - Age + Capacity ) % Capacity]; }
+
+	TStaticArray<FPoseSnapshot, Capacity> Snapshots;
+
+	// Index the next snapshot is written to
+	int32 Head = 0;
+	int32 Count = 0;
+};
@@ -0,0 +1,394 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ProjectileBatchManager.h"
+#include "NetworkProjectile.h"
+#include "CapstoneCharacter.h"
+#include "LagCompensationSubsystem.h"
+#include "CapstoneStats.h"
+
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Net/UnrealNetwork.h"
+
+void FBatchedProjectileItem::PostReplicatedAdd( const FBatchedProjectileArray& InArraySerializer )
+{
+	if ( InArraySerializer.Owner ) InArraySerializer.Owner->OnProjectileAdded( *this );
+}
+
+void FBatchedProjectileItem::PreReplicatedRemove( const FBatchedProjectileArray& InArraySerializer )
+{
+	if ( InArraySerializer.Owner ) InArraySerializer.Owner->OnProjectileRemoved( *this );
+}
+
+AProjectileBatchManager::AProjectileBatchManager()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	SetReplicatingMovement( false );
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>( TEXT( "Root" ) );
+
+	ReplicatedProjectiles.Owner = this;
+}
+
+AProjectileBatchManager* AProjectileBatchManager::Get( const UObject* WorldContextObject )
+{
+	UWorld* World = GEngine->GetWorldFromContextObject( WorldContextObject, EGetWorldErrorMode::ReturnNull );
+	if ( !World ) return nullptr;
+
+	for ( TActorIterator<AProjectileBatchManager> It( World ); It; ++It )
+	{
+		return *It;
+	}
+
+	if ( World->GetNetMode() == NM_Client ) return nullptr;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	return World->SpawnActor<AProjectileBatchManager>( SpawnParameters );
+}
+
+void AProjectileBatchManager::GetLifetimeReplicatedProps( TArray <FLifetimeProperty>& OutLifetimeProps ) const
+{
+	Super::GetLifetimeReplicatedProps( OutLifetimeProps );
+
+	DOREPLIFETIME( AProjectileBatchManager, ProjectileTypes );
+	DOREPLIFETIME( AProjectileBatchManager, ReplicatedProjectiles );
+}
+
+float AProjectileBatchManager::GetServerTime() const
+{
+	if ( const AGameStateBase* GameState = GetWorld()->GetGameState() ) return GameState->GetServerWorldTimeSeconds();
+	return GetWorld()->GetTimeSeconds();
+}
+
+int32 AProjectileBatchManager::FindOrAddProjectileType( TSubclassOf<ANetworkProjectile> ProjectileClass )
+{
+	int32 TypeIndex = ProjectileTypes.Find( ProjectileClass );
+	if ( TypeIndex == INDEX_NONE && HasAuthority() && ProjectileTypes.Num() <= MAX_uint8 )
+	{
+		TypeIndex = ProjectileTypes.Add( ProjectileClass );
+	}
+	return TypeIndex;
+}
+
+void AProjectileBatchManager::RegisterProjectileType( TSubclassOf<ANetworkProjectile> ProjectileClass )
+{
+	if ( ProjectileClass ) FindOrAddProjectileType( ProjectileClass );
+}
+
+void AProjectileBatchManager::FireProjectile( TSubclassOf<ANetworkProjectile> ProjectileClass, const FVector& Origin, const FVector& Direction, AActor* ProjectileOwner, const uint16 PredictionKey, const float RewindSeconds )
+{
+	if ( !HasAuthority() || !ProjectileClass ) return;
+
+	const int32 TypeIndex = FindOrAddProjectileType( ProjectileClass );
+	if ( TypeIndex == INDEX_NONE ) return;
+
+	const ANetworkProjectile* Defaults = ProjectileClass->GetDefaultObject<ANetworkProjectile>();
+	const FVector Velocity = Direction.GetSafeNormal() * Defaults->ProjectileMovementComponent->InitialSpeed;
+
+	Positions.Add( Origin );
+	Velocities.Add( Velocity );
+	Owners.Add( ProjectileOwner );
+	Damages.Add( Defaults->Damage );
+	Radii.Add( Defaults->SphereComponent->GetUnscaledSphereRadius() );
+	RemainingLife.Add( ProjectileLifeSpan );
+	TypeIndices.Add( static_cast<uint8>( TypeIndex ) );
+
+	const ULagCompensationSubsystem* LagCompensation = GetWorld()->GetSubsystem<ULagCompensationSubsystem>();
+	RewindOffsets.Add( LagCompensation ? LagCompensation->ClampRewind( RewindSeconds ) : 0.0f );
+	SweepHandles.AddDefaulted();
+
+	FBatchedProjectileItem& Item = ReplicatedProjectiles.Items.AddDefaulted_GetRef();
+	Item.TypeIndex = static_cast<uint8>( TypeIndex );
+	Item.Origin = Origin;
+	Item.Velocity = Velocity;
+	Item.SpawnTime = GetServerTime();
+	Item.Shooter = ProjectileOwner;
+	Item.PredictionKey = PredictionKey;
+	ReplicatedProjectiles.MarkItemDirty( Item );
+}
+
+void AProjectileBatchManager::FirePredictedProjectile( TSubclassOf<ANetworkProjectile> ProjectileClass, const FVector& Origin, const FVector& Direction, AActor* ProjectileOwner, const uint16 PredictionKey )
+{
+	// Types are assigned by the server, a class it never registered cannot be drawn yet
+	const int32 TypeIndex = ProjectileClass ? ProjectileTypes.Find( ProjectileClass ) : INDEX_NONE;
+	if ( TypeIndex == INDEX_NONE ) return;
+
+	const ANetworkProjectile* Defaults = ProjectileClass->GetDefaultObject<ANetworkProjectile>();
+
+	FBatchedProjectileItem& Item = PredictedProjectiles.AddDefaulted_GetRef();
+	Item.TypeIndex = static_cast<uint8>( TypeIndex );
+	Item.Origin = Origin;
+	Item.Velocity = Direction.GetSafeNormal() * Defaults->ProjectileMovementComponent->InitialSpeed;
+	Item.SpawnTime = GetServerTime();
+	Item.Shooter = ProjectileOwner;
+	Item.PredictionKey = PredictionKey;
+}
+
+void AProjectileBatchManager::RejectPredictedProjectiles( const AActor* ProjectileOwner, const TArray<uint16>& PredictionKeys )
+{
+	PredictedProjectiles.RemoveAllSwap( [ProjectileOwner, &PredictionKeys]( const FBatchedProjectileItem& Predicted )
+	{
+		return Predicted.Shooter == ProjectileOwner && PredictionKeys.Contains( Predicted.PredictionKey );
+	}, false );
+}
+
+void AProjectileBatchManager::OnProjectileAdded( FBatchedProjectileItem& Item )
+{
+	// Remote shooters never call FireShot on this machine, their replicated shots are what marks them as in combat
+	if ( ACapstoneCharacter* Shooter = Cast<ACapstoneCharacter>( Item.Shooter ) ) Shooter->NotifyCombat();
+
+	if ( Item.PredictionKey == 0 ) return;
+
+	const int32 PredictedIndex = PredictedProjectiles.IndexOfByPredicate( [&Item]( const FBatchedProjectileItem& Predicted )
+	{
+		return Predicted.Shooter == Item.Shooter && Predicted.PredictionKey == Item.PredictionKey;
+	} );
+	if ( PredictedIndex == INDEX_NONE ) return;
+
+	// The server confirmed the shot. Keep drawing it from where the client predicted it so it does not pop back by
+	// the round trip, unless the server had to move the muzzle, in which case the authoritative origin wins.
+	const FBatchedProjectileItem& Predicted = PredictedProjectiles[PredictedIndex];
+	if ( FVector::DistSquared( Predicted.Origin, Item.Origin ) <= FMath::Square( ReconcileTolerance ) )
+	{
+		Item.Origin = Predicted.Origin;
+		Item.SpawnTime = Predicted.SpawnTime;
+	}
+
+	PredictedProjectiles.RemoveAtSwap( PredictedIndex, 1, false );
+}
+
+void AProjectileBatchManager::Tick( float DeltaTime )
+{
+	Super::Tick( DeltaTime );
+
+	if ( HasAuthority() ) SimulateProjectiles( DeltaTime );
+	else SimulatePredictedProjectiles();
+
+	if ( GetNetMode() != NM_DedicatedServer ) UpdateInstances();
+}
+
+void AProjectileBatchManager::SimulateProjectiles( const float DeltaTime )
+{
+	if ( Positions.Num() == 0 ) return;
+
+	CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_BatchedProjectileSimulate );
+
+	UWorld* World = GetWorld();
+	const ULagCompensationSubsystem* LagCompensation = World->GetSubsystem<ULagCompensationSubsystem>();
+
+	// The sweeps submitted last frame ran in parallel with the rest of that frame, their hits are applied first.
+	// Back to front so RemoveAtSwap only ever moves already processed entries
+	for ( int32 i = Positions.Num() - 1; i >= 0; --i )
+	{
+		FTraceDatum Datum;
+		if ( SweepHandles[i].IsValid() && World->QueryTraceData( SweepHandles[i], Datum ) && ResolveSweep( i, Datum, LagCompensation ) ) continue;
+
+		// Expired last frame, retired only now that its final segment has been swept
+		if ( RemainingLife[i] <= 0.0f ) RemoveProjectile( i, false );
+	}
+
+	if ( Positions.Num() == 0 ) return;
+
+	// Integrate every projectile in one pass over contiguous memory. One expiring mid-frame only flies the time it had left
+	const int32 Num = Positions.Num();
+	FVector* RESTRICT Position = Positions.GetData();
+	const FVector* RESTRICT Velocity = Velocities.GetData();
+	float* RESTRICT Life = RemainingLife.GetData();
+	for ( int32 i = 0; i < Num; ++i )
+	{
+		Life[i] -= DeltaTime;
+		Position[i] += Velocity[i] * ( DeltaTime + FMath::Min( Life[i], 0.0f ) );
+	}
+
+	// Characters are excluded from the physics sweep and tested against their rewound hitboxes instead,
+	// so the shooter hits what it saw when it fired rather than where targets are now
+	FCollisionQueryParams Params( SCENE_QUERY_STAT( BatchedProjectileSweep ), false, this );
+	if ( LagCompensation )
+	{
+		for ( ACapstoneCharacter* Character : LagCompensation->GetCharacters() ) Params.AddIgnoredActor( Character );
+	}
+
+	// Every sweep of the frame is submitted to the async trace queue, the physics scene runs them off the game thread
+	SweepTime = World->GetTimeSeconds();
+	for ( int32 i = Num - 1; i >= 0; --i )
+	{
+		const FVector SweepStart = Positions[i] - Velocities[i] * ( DeltaTime + FMath::Min( RemainingLife[i], 0.0f ) );
+		const FCollisionShape Shape = FCollisionShape::MakeSphere( Radii[i] );
+
+		AActor* ProjectileOwner = Owners[i].Get();
+		if ( !LagCompensation || ( ProjectileOwner && !ProjectileOwner->IsA<ACapstoneCharacter>() ) )
+		{
+			FCollisionQueryParams OwnerParams( Params );
+			OwnerParams.AddIgnoredActor( ProjectileOwner );
+			SweepHandles[i] = World->AsyncSweepByProfile( EAsyncTraceType::Single, SweepStart, Positions[i], FQuat::Identity, CollisionProfile, Shape, OwnerParams );
+		}
+		else
+		{
+			SweepHandles[i] = World->AsyncSweepByProfile( EAsyncTraceType::Single, SweepStart, Positions[i], FQuat::Identity, CollisionProfile, Shape, Params );
+		}
+	}
+}
+
+bool AProjectileBatchManager::ResolveSweep( const int32 Index, const FTraceDatum& Datum, const ULagCompensationSubsystem* LagCompensation )
+{
+	AActor* ProjectileOwner = Owners[Index].Get();
+
+	FHitResult Hit = Datum.OutHits.Num() > 0 ? Datum.OutHits[0] : FHitResult();
+	bool bHit = Hit.bBlockingHit;
+
+	// Characters are tested as they were when the sweep was submitted, minus the shooter's latency
+	FHitResult RewoundHit;
+	if ( LagCompensation && LagCompensation->SweepRewound( Datum.Start, Datum.End, Radii[Index], SweepTime - RewindOffsets[Index], ProjectileOwner, RewoundHit ) )
+	{
+		if ( !bHit || RewoundHit.Time < Hit.Time ) Hit = RewoundHit;
+		bHit = true;
+	}
+
+	if ( !bHit ) return false;
+
+	if ( AActor* HitActor = Hit.GetActor() )
+	{
+		CAPSTONE_SCOPE_CYCLE_COUNTER( STAT_ProjectileImpact );
+
+		const APawn* InstigatorPawn = Cast<APawn>( ProjectileOwner );
+		const TSubclassOf<UDamageType> DamageType = ProjectileTypes[TypeIndices[Index]]->GetDefaultObject<ANetworkProjectile>()->DamageType;
+		UGameplayStatics::ApplyPointDamage( HitActor, Damages[Index], Velocities[Index].GetSafeNormal(), Hit, InstigatorPawn ? InstigatorPawn->GetController() : nullptr, ProjectileOwner, DamageType );
+	}
+
+	Positions[Index] = Hit.Location;
+	RemoveProjectile( Index, true );
+	return true;
+}
+
+void AProjectileBatchManager::SimulatePredictedProjectiles()
+{
+	if ( PredictedProjectiles.Num() == 0 ) return;
+
+	// Predicted projectiles are cosmetic, a line trace against the world is enough to stop them at walls
+	const float Now = GetServerTime();
+	const float DeltaTime = GetWorld()->GetDeltaSeconds();
+	FCollisionQueryParams Params( SCENE_QUERY_STAT( PredictedProjectileTrace ), false, this );
+	for ( int32 i = PredictedProjectiles.Num() - 1; i >= 0; --i )
+	{
+		const FBatchedProjectileItem& Predicted = PredictedProjectiles[i];
+		if ( Now - Predicted.SpawnTime > PredictionTimeout )
+		{
+			PredictedProjectiles.RemoveAtSwap( i, 1, false );
+			continue;
+		}
+
+		Params.ClearIgnoredActors();
+		Params.AddIgnoredActor( this );
+		Params.AddIgnoredActor( Predicted.Shooter );
+
+		FHitResult Hit;
+		const FVector End = Predicted.GetLocationAt( Now );
+		if ( GetWorld()->LineTraceSingleByChannel( Hit, End - Predicted.Velocity * DeltaTime, End, ECC_Visibility, Params ) )
+		{
+			SpawnImpactEffect( Predicted.TypeIndex, Hit.Location );
+			PredictedProjectiles.RemoveAtSwap( i, 1, false );
+		}
+	}
+}
+
+void AProjectileBatchManager::RemoveProjectile( const int32 Index, const bool bImpact )
+{
+	if ( bImpact && GetNetMode() != NM_DedicatedServer ) SpawnImpactEffect( TypeIndices[Index], Positions[Index] );
+
+	Positions.RemoveAtSwap( Index, 1, false );
+	Velocities.RemoveAtSwap( Index, 1, false );
+	Owners.RemoveAtSwap( Index, 1, false );
+	Damages.RemoveAtSwap( Index, 1, false );
+	Radii.RemoveAtSwap( Index, 1, false );
+	RemainingLife.RemoveAtSwap( Index, 1, false );
+	TypeIndices.RemoveAtSwap( Index, 1, false );
+	RewindOffsets.RemoveAtSwap( Index, 1, false );
+	SweepHandles.RemoveAtSwap( Index, 1, false );
+
+	ReplicatedProjectiles.Items.RemoveAtSwap( Index, 1, false );
+	ReplicatedProjectiles.MarkArrayDirty();
+}
+
+void AProjectileBatchManager::OnProjectileRemoved( const FBatchedProjectileItem& Item )
+{
+	// Items that outlived their life span expired without hitting anything
+	const float Now = GetServerTime();
+	if ( Now - Item.SpawnTime < ProjectileLifeSpan ) SpawnImpactEffect( Item.TypeIndex, Item.GetLocationAt( Now ) );
+}
+
+void AProjectileBatchManager::SpawnImpactEffect( const uint8 TypeIndex, const FVector& Location ) const
+{
+	if ( !ProjectileTypes.IsValidIndex( TypeIndex ) || !ProjectileTypes[TypeIndex] ) return;
+
+	UParticleSystem* ExplosionEffect = ProjectileTypes[TypeIndex]->GetDefaultObject<ANetworkProjectile>()->ExplosionEffect;
+	UGameplayStatics::SpawnEmitterAtLocation( this, ExplosionEffect, Location, FRotator::ZeroRotator, true, EPSCPoolMethod::AutoRelease );
+}
+
+void AProjectileBatchManager::UpdateInstances()
+{
+	const float Now = GetServerTime();
+
+	for ( int32 TypeIndex = 0; TypeIndex < ProjectileTypes.Num(); ++TypeIndex )
+	{
+		UInstancedStaticMeshComponent* Instances = GetInstancesForType( TypeIndex );
+		if ( !Instances ) continue;
+
+		const FVector Scale = ProjectileTypes[TypeIndex]->GetDefaultObject<ANetworkProjectile>()->StaticMesh->GetRelativeScale3D();
+
+		InstanceTransforms.Reset();
+		for ( const FBatchedProjectileItem& Item : ReplicatedProjectiles.Items )
+		{
+			if ( Item.TypeIndex != TypeIndex ) continue;
+			InstanceTransforms.Emplace( Item.Velocity.ToOrientationQuat(), Item.GetLocationAt( Now ), Scale );
+		}
+		for ( const FBatchedProjectileItem& Item : PredictedProjectiles )
+		{
+			if ( Item.TypeIndex != TypeIndex ) continue;
+			InstanceTransforms.Emplace( Item.Velocity.ToOrientationQuat(), Item.GetLocationAt( Now ), Scale );
+		}
+
+		if ( InstanceTransforms.Num() == 0 && Instances->GetInstanceCount() == 0 ) continue;
+
+		while ( Instances->GetInstanceCount() > InstanceTransforms.Num() )
+		{
+			Instances->RemoveInstance( Instances->GetInstanceCount() - 1 );
+		}
+		while ( Instances->GetInstanceCount() < InstanceTransforms.Num() )
+		{
+			Instances->AddInstance( InstanceTransforms[Instances->GetInstanceCount()], true );
+		}
+
+		Instances->BatchUpdateInstancesTransforms( 0, InstanceTransforms, true, true, true );
+	}
+}
+
+UInstancedStaticMeshComponent* AProjectileBatchManager::GetInstancesForType( const uint8 TypeIndex )
+{
+	if ( !ProjectileTypes.IsValidIndex( TypeIndex ) || !ProjectileTypes[TypeIndex] ) return nullptr;
+
+	if ( TypeInstances.Num() <= TypeIndex ) TypeInstances.SetNumZeroed( TypeIndex + 1 );
+
+	if ( !TypeInstances[TypeIndex] )
+	{
+		const ANetworkProjectile* Defaults = ProjectileTypes[TypeIndex]->GetDefaultObject<ANetworkProjectile>();
+
+		UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>( this );
+		Instances->SetStaticMesh( Defaults->StaticMesh->GetStaticMesh() );
+		Instances->SetCollisionEnabled( ECollisionEnabled::NoCollision );
+		Instances->SetupAttachment( RootComponent );
+		Instances->RegisterComponent();
+		TypeInstances[TypeIndex] = Instances;
+	}
+
+	return TypeInstances[TypeIndex];
+}
@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "WorldCollision.h"
+#include "ProjectileBatchManager.generated.h"
+
+class ANetworkProjectile;
+class AProjectileBatchManager;
+class UInstancedStaticMeshComponent;
+class ULagCompensationSubsystem;
+
+// Replicated spawn data of one batched projectile. Clients extrapolate the position from Origin, Velocity and SpawnTime.
+USTRUCT()
+struct FBatchedProjectileItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint8 TypeIndex = 0;
+
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	UPROPERTY()
+	FVector_NetQuantize Velocity;
+
+	UPROPERTY()
+	float SpawnTime = 0.0f;
+
+	// Pawn that fired the projectile, used by its owning client to match the projectile with its prediction
+	UPROPERTY()
+	AActor* Shooter = nullptr;
+
+	// Key the shooting client tagged its predicted shot with, 0 if the shot was not predicted
+	UPROPERTY()
+	uint16 PredictionKey = 0;
+
+	FORCEINLINE FVector GetLocationAt( const float Time ) const { return Origin + Velocity * ( Time - SpawnTime ); }
+
+	void PostReplicatedAdd( const struct FBatchedProjectileArray& InArraySerializer );
+	void PreReplicatedRemove( const struct FBatchedProjectileArray& InArraySerializer );
+};
+
+// Every live batched projectile, delta serialized so only spawns and removals go over the wire
+USTRUCT()
+struct FBatchedProjectileArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FBatchedProjectileItem> Items;
+
+	UPROPERTY( NotReplicated )
+	AProjectileBatchManager* Owner = nullptr;
+
+	bool NetDeltaSerialize( FNetDeltaSerializeInfo& DeltaParms )
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FBatchedProjectileItem, FBatchedProjectileArray>( Items, DeltaParms, *this );
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FBatchedProjectileArray> : public TStructOpsTypeTraitsBase2<FBatchedProjectileArray>
+{
+	enum { WithNetDeltaSerializer = true };
+};
+
+/**
+ * Simulates every projectile in the world on the server as plain data instead of one replicated actor per shot.
+ * State is kept as a struct of arrays and stepped in a single pass per frame. The sweeps of a frame are submitted
+ * together as async traces and their hits applied at the start of the next frame, like UHitScanSubsystem does.
+ * Clients receive one fast array of spawn records and draw all projectiles of a type with a single instanced mesh.
+ */
+UCLASS()
+class CAPSTONE_API AProjectileBatchManager : public AActor
+{
+	GENERATED_BODY()
+
+	// Reads the rewind each confirmed shot was given
+	friend class FCapstoneHandleFireTest;
+
+public:
+	AProjectileBatchManager();
+
+	/** Finds the manager of the world, spawning it on the server if it does not exist yet.*/
+	static AProjectileBatchManager* Get( const UObject* WorldContextObject );
+
+	virtual void Tick( float DeltaTime ) override;
+
+	void GetLifetimeReplicatedProps( TArray<FLifetimeProperty>& OutLifetimeProps ) const override;
+
+	/** Makes ProjectileClass known to clients before its first shot so they can predict it.*/
+	void RegisterProjectileType( TSubclassOf<ANetworkProjectile> ProjectileClass );
+
+	/**
+	 * Launches a projectile using the speed, damage and radius of ProjectileClass' defaults. Server only.
+	 * Characters it sweeps through are tested as they were RewindSeconds ago, the latency of the shooter.
+	 */
+	void FireProjectile( TSubclassOf<ANetworkProjectile> ProjectileClass, const FVector& Origin, const FVector& Direction, AActor* ProjectileOwner, const uint16 PredictionKey = 0, const float RewindSeconds = 0.0f );
+
+	/** Spawns a cosmetic projectile on the shooting client until the server confirms or rejects the shot.*/
+	void FirePredictedProjectile( TSubclassOf<ANetworkProjectile> ProjectileClass, const FVector& Origin, const FVector& Direction, AActor* ProjectileOwner, const uint16 PredictionKey );
+
+	/** Removes cosmetic projectiles the server refused to fire.*/
+	void RejectPredictedProjectiles( const AActor* ProjectileOwner, const TArray<uint16>& PredictionKeys );
+
+	FORCEINLINE int32 GetNumProjectiles() const { return Positions.Num(); }
+
+	float GetServerTime() const;
+
+	// Called on clients when a projectile is added to the replicated array
+	void OnProjectileAdded( FBatchedProjectileItem& Item );
+
+	// Called on clients when a projectile is removed from the replicated array
+	void OnProjectileRemoved( const FBatchedProjectileItem& Item );
+
+protected:
+	int32 FindOrAddProjectileType( TSubclassOf<ANetworkProjectile> ProjectileClass );
+
+	void SimulateProjectiles( const float DeltaTime );
+
+	/** Applies the result of the async sweep of the projectile at Index. Returns true if it hit something and was removed.*/
+	bool ResolveSweep( const int32 Index, const FTraceDatum& Datum, const ULagCompensationSubsystem* LagCompensation );
+	void SimulatePredictedProjectiles();
+	void RemoveProjectile( const int32 Index, const bool bImpact );
+	void SpawnImpactEffect( const uint8 TypeIndex, const FVector& Location ) const;
+	void UpdateInstances();
+
+	UInstancedStaticMeshComponent* GetInstancesForType( const uint8 TypeIndex );
+
+	/** Projectile classes the manager has seen. Items reference them by index so a type costs one byte on the wire.*/
+	UPROPERTY( Replicated )
+	TArray<TSubclassOf<ANetworkProjectile>> ProjectileTypes;
+
+	UPROPERTY( Replicated )
+	FBatchedProjectileArray ReplicatedProjectiles;
+
+	UPROPERTY( Transient )
+	TArray<UInstancedStaticMeshComponent*> TypeInstances;
+
+	/** Seconds a batched projectile lives without hitting anything.*/
+	UPROPERTY( EditAnywhere, Category = "Projectile" )
+	float ProjectileLifeSpan = 5.0f;
+
+	/** Seconds a predicted projectile waits for the server before it is dropped.*/
+	UPROPERTY( EditAnywhere, Category = "Projectile" )
+	float PredictionTimeout = 1.0f;
+
+	/** Distance between the predicted and the confirmed origin below which the client keeps its predicted path.*/
+	UPROPERTY( EditAnywhere, Category = "Projectile" )
+	float ReconcileTolerance = 50.0f;
+
+	/** Collision profile used by the per-frame sweeps, matches the profile of ANetworkProjectile's sphere.*/
+	UPROPERTY( EditAnywhere, Category = "Projectile" )
+	FName CollisionProfile = FName( "BlockAllDynamic" );
+
+	// Server-side simulation state, one entry per live projectile at the same index in every array
+	TArray<FVector> Positions;
+	TArray<FVector> Velocities;
+	TArray<TWeakObjectPtr<AActor>> Owners;
+	TArray<float> Damages;
+	TArray<float> Radii;
+	TArray<float> RemainingLife;
+	TArray<uint8> TypeIndices;
+	TArray<float> RewindOffsets;
+
+	// Async sweep submitted for each projectile last frame, read back at the start of this one
+	TArray<FTraceHandle> SweepHandles;
+
+	// World time the pending sweeps were submitted at, characters are rewound from it
+	float SweepTime = 0.0f;
+
+	// Cosmetic projectiles fired by the local player that the server has not confirmed yet. Never replicated.
+	TArray<FBatchedProjectileItem> PredictedProjectiles;
+
+	// Scratch buffer reused every frame when pushing instance transforms
+	TArray<FTransform> InstanceTransforms;
+};
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ProjectilePoolSubsystem.h"
+#include "NetworkProjectile.h"
+
+#include "Engine/World.h"
+
+DEFINE_LOG_CATEGORY( LogProjectilePool );
+
+bool UProjectilePoolSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UProjectilePoolSubsystem::Deinitialize()
+{
+	UE_LOG( LogProjectilePool, Log, TEXT( "Projectile pool shutting down: %d hits, %d misses" ), PoolHits, PoolMisses );
+
+	Pools.Empty();
+
+	Super::Deinitialize();
+}
+
+void UProjectilePoolSubsystem::Prewarm( TSubclassOf<ANetworkProjectile> ProjectileClass, int32 Count )
+{
+	if ( !ProjectileClass || GetWorld()->GetNetMode() == NM_Client ) return;
+
+	if ( Count <= 0 ) Count = DefaultPrewarmCount;
+
+	FProjectilePoolBucket& Bucket = Pools.FindOrAdd( ProjectileClass );
+	const int32 Target = FMath::Min( Count, MaxPooledPerClass );
+
+	Bucket.Inactive.Reserve( Target );
+	while ( Bucket.Inactive.Num() < Target )
+	{
+		ANetworkProjectile* Projectile = SpawnPooledProjectile( ProjectileClass );
+		if ( !Projectile ) break;
+
+		Projectile->DeactivateToPool();
+		Bucket.Inactive.Add( Projectile );
+	}
+}
+
+ANetworkProjectile* UProjectilePoolSubsystem::AcquireProjectile( TSubclassOf<ANetworkProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator )
+{
+	if ( !ProjectileClass ) return nullptr;
+
+	ANetworkProjectile* Projectile = nullptr;
+
+	if ( FProjectilePoolBucket* Bucket = Pools.Find( ProjectileClass ) )
+	{
+		while ( !Projectile && Bucket->Inactive.Num() > 0 )
+		{
+			// Entries can go stale if something else destroyed a pooled projectile
+			Projectile = Bucket->Inactive.Pop( false );
+			if ( !IsValid( Projectile ) ) Projectile = nullptr;
+		}
+	}
+
+	if ( Projectile )
+	{
+		++PoolHits;
+	}
+	else
+	{
+		++PoolMisses;
+		Projectile = SpawnPooledProjectile( ProjectileClass );
+		if ( !Projectile ) return nullptr;
+	}
+
+	Projectile->ActivateFromPool( SpawnTransform, NewOwner, NewInstigator );
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::ReleaseProjectile( ANetworkProjectile* Projectile )
+{
+	if ( !IsValid( Projectile ) || !Projectile->IsPooledActive() ) return;
+
+	FProjectilePoolBucket& Bucket = Pools.FindOrAdd( Projectile->GetClass() );
+	if ( Bucket.Inactive.Num() >= MaxPooledPerClass )
+	{
+		Projectile->Destroy();
+		return;
+	}
+
+	Projectile->DeactivateToPool();
+	Bucket.Inactive.Add( Projectile );
+}
+
+int32 UProjectilePoolSubsystem::GetNumPooled( TSubclassOf<ANetworkProjectile> ProjectileClass ) const
+{
+	const FProjectilePoolBucket* Bucket = Pools.Find( ProjectileClass );
+	return Bucket ? Bucket->Inactive.Num() : 0;
+}
+
+ANetworkProjectile* UProjectilePoolSubsystem::SpawnPooledProjectile( TSubclassOf<ANetworkProjectile> ProjectileClass )
+{
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// Pooled projectiles are parked out of the way and only ever moved by ActivateFromPool
+	return GetWorld()->SpawnActor<ANetworkProjectile>( ProjectileClass, FVector::ZeroVector, FRotator::ZeroRotator, SpawnParameters );
+}
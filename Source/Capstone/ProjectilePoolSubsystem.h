@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectilePoolSubsystem.generated.h"
+
+class ANetworkProjectile;
+
+DECLARE_LOG_CATEGORY_EXTERN( LogProjectilePool, Log, All );
+
+// Inactive projectiles of a single class, waiting to be reused
+USTRUCT()
+struct FProjectilePoolBucket
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<ANetworkProjectile*> Inactive;
+};
+
+/**
+ * Preallocates and recycles ANetworkProjectile actors so that firing never has to go through SpawnActor/Destroy.
+ * Only the server owns pooled projectiles, clients see them through normal actor replication.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API UProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Tops the pool up to at least Count inactive projectiles of the given class so the first shots do not hitch.*/
+	UFUNCTION( BlueprintCallable, Category = "Projectile Pool" )
+	void Prewarm( TSubclassOf<ANetworkProjectile> ProjectileClass, int32 Count );
+
+	/** Takes a projectile out of the pool (or spawns one on a miss) and launches it from SpawnTransform.*/
+	UFUNCTION( BlueprintCallable, Category = "Projectile Pool" )
+	ANetworkProjectile* AcquireProjectile( TSubclassOf<ANetworkProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* NewOwner, APawn* NewInstigator );
+
+	/** Puts a projectile back into the pool. Projectiles above MaxPooledPerClass are destroyed instead.*/
+	UFUNCTION( BlueprintCallable, Category = "Projectile Pool" )
+	void ReleaseProjectile( ANetworkProjectile* Projectile );
+
+	UFUNCTION( BlueprintPure, Category = "Projectile Pool" )
+	FORCEINLINE int32 GetPoolHits() const { return PoolHits; }
+
+	UFUNCTION( BlueprintPure, Category = "Projectile Pool" )
+	FORCEINLINE int32 GetPoolMisses() const { return PoolMisses; }
+
+	UFUNCTION( BlueprintPure, Category = "Projectile Pool" )
+	int32 GetNumPooled( TSubclassOf<ANetworkProjectile> ProjectileClass ) const;
+
+protected:
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	ANetworkProjectile* SpawnPooledProjectile( TSubclassOf<ANetworkProjectile> ProjectileClass );
+
+	/** How many projectiles Prewarm spawns when called with a non-positive count.*/
+	UPROPERTY( config )
+	int32 DefaultPrewarmCount = 32;
+
+	/** Upper bound of inactive projectiles kept around per class.*/
+	UPROPERTY( config )
+	int32 MaxPooledPerClass = 256;
+
+	UPROPERTY()
+	TMap<TSubclassOf<ANetworkProjectile>, FProjectilePoolBucket> Pools;
+
+	// Acquires served from the pool
+	int32 PoolHits = 0;
+
+	// Acquires that had to spawn a new actor
+	int32 PoolMisses = 0;
+};
@@ -0,0 +1,187 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RagdollSubsystem.h"
+#include "CapstoneSignificanceManager.h"
+#include "CapstoneStats.h"
+
+#include "Animation/AnimSequence.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkinnedAsset.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "PhysicsEngine/PhysicsAsset.h"
+
+bool URagdollSubsystem::ShouldCreateSubsystem( UObject* Outer ) const
+{
+	// A dedicated server has nobody to show a ragdoll to
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem( Outer );
+}
+
+bool URagdollSubsystem::DoesSupportWorldType( const EWorldType::Type WorldType ) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId URagdollSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT( URagdollSubsystem, STATGROUP_Tickables );
+}
+
+void URagdollSubsystem::StartDeath( ACharacter* Character, UAnimSequence* DeathAnimation, UPhysicsAsset* RagdollPhysicsAsset )
+{
+	if ( !Character ) return;
+
+	RemoveCharacter( Character );
+
+	// The dead body is no longer animated by gameplay, it should not hold an animation budget slot either
+	UCapstoneSignificanceManager::UnregisterCharacter( Character );
+
+	Character->GetCapsuleComponent()->SetCollisionEnabled( ECollisionEnabled::NoCollision );
+	Character->GetCharacterMovement()->DisableMovement();
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	Mesh->SetComponentTickEnabled( true );
+	Mesh->SetComponentTickInterval( 0.0f );
+
+	if ( !ShouldSimulate( Character ) )
+	{
+		if ( DeathAnimation ) Mesh->PlayAnimation( DeathAnimation, false );
+		return;
+	}
+
+	if ( NumSimulated >= MaxSimulatedRagdolls ) FreezeOldestSimulating();
+
+	SimulateRagdoll( Character, RagdollPhysicsAsset );
+
+	FRagdoll& Ragdoll = Ragdolls.AddDefaulted_GetRef();
+	Ragdoll.Character = Character;
+	Ragdoll.StartTime = GetWorld()->GetTimeSeconds();
+	NumSimulated++;
+}
+
+void URagdollSubsystem::Revive( ACharacter* Character )
+{
+	if ( !Character ) return;
+
+	RemoveCharacter( Character );
+
+	const ACharacter* Defaults = Character->GetClass()->GetDefaultObject<ACharacter>();
+
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	Mesh->SetSimulatePhysics( false );
+	Mesh->bNoSkeletonUpdate = false;
+	Mesh->SetComponentTickEnabled( true );
+	Mesh->SetCollisionProfileName( Defaults->GetMesh()->GetCollisionProfileName() );
+	if ( Mesh->GetSkinnedAsset() ) Mesh->SetPhysicsAsset( Mesh->GetSkinnedAsset()->GetPhysicsAsset() );
+
+	// Simulating detached the mesh from the capsule, and a death animation replaced the animation blueprint
+	Mesh->AttachToComponent( Character->GetCapsuleComponent(), FAttachmentTransformRules::SnapToTargetNotIncludingScale );
+	Mesh->SetRelativeLocationAndRotation( Character->GetBaseTranslationOffset(), Character->GetBaseRotationOffset() );
+	if ( Mesh->GetAnimationMode() != EAnimationMode::AnimationBlueprint ) Mesh->SetAnimationMode( EAnimationMode::AnimationBlueprint );
+
+	Character->GetCapsuleComponent()->SetCollisionEnabled( Defaults->GetCapsuleComponent()->GetCollisionEnabled() );
+	Character->GetCharacterMovement()->SetDefaultMovementMode();
+
+	UCapstoneSignificanceManager::RegisterCharacter( Character );
+}
+
+void URagdollSubsystem::RemoveCharacter( ACharacter* Character )
+{
+	const int32 Index = Ragdolls.IndexOfByPredicate( [Character]( const FRagdoll& Ragdoll ) { return Ragdoll.Character == Character; } );
+	if ( Index == INDEX_NONE ) return;
+
+	if ( Ragdolls[Index].State != ERagdollState::Frozen ) NumSimulated--;
+	Ragdolls.RemoveAt( Index );
+}
+
+bool URagdollSubsystem::ShouldSimulate( const ACharacter* Character ) const
+{
+	if ( MaxSimulatedRagdolls <= 0 || !Character->GetMesh()->WasRecentlyRendered( 0.2f ) ) return false;
+
+	const FVector Location = Character->GetActorLocation();
+	for ( FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It )
+	{
+		const APlayerController* PlayerController = It->Get();
+		if ( !PlayerController || !PlayerController->IsLocalController() ) continue;
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint( ViewLocation, ViewRotation );
+		if ( FVector::DistSquared( ViewLocation, Location ) <= FMath::Square( MaxRagdollDistance ) ) return true;
+	}
+
+	return false;
+}
+
+void URagdollSubsystem::SimulateRagdoll( ACharacter* Character, UPhysicsAsset* RagdollPhysicsAsset )
+{
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+
+	// A ragdoll specific physics asset can use far fewer bodies than the one used for hit detection
+	if ( RagdollPhysicsAsset ) Mesh->SetPhysicsAsset( RagdollPhysicsAsset );
+
+	Mesh->SetCollisionProfileName( TEXT( "Ragdoll" ) );
+	Mesh->SetSimulatePhysics( true );
+}
+
+void URagdollSubsystem::Freeze( FRagdoll& Ragdoll )
+{
+	if ( Ragdoll.State == ERagdollState::Frozen ) return;
+
+	Ragdoll.State = ERagdollState::Frozen;
+	NumSimulated--;
+
+	ACharacter* Character = Ragdoll.Character.Get();
+	if ( !Character ) return;
+
+	// Stop updating the skeleton first so turning physics off keeps the last simulated pose
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+	Mesh->bNoSkeletonUpdate = true;
+	Mesh->SetSimulatePhysics( false );
+	Mesh->SetCollisionEnabled( ECollisionEnabled::NoCollision );
+	Mesh->SetComponentTickEnabled( false );
+}
+
+void URagdollSubsystem::FreezeOldestSimulating()
+{
+	for ( FRagdoll& Ragdoll : Ragdolls )
+	{
+		if ( Ragdoll.State == ERagdollState::Frozen ) continue;
+
+		Freeze( Ragdoll );
+		return;
+	}
+}
+
+void URagdollSubsystem::Tick( float DeltaTime )
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	for ( int32 Index = Ragdolls.Num() - 1; Index >= 0; --Index )
+	{
+		FRagdoll& Ragdoll = Ragdolls[Index];
+		ACharacter* Character = Ragdoll.Character.Get();
+		if ( !Character )
+		{
+			if ( Ragdoll.State != ERagdollState::Frozen ) NumSimulated--;
+			Ragdolls.RemoveAt( Index );
+			continue;
+		}
+
+		const float Age = Now - Ragdoll.StartTime;
+		if ( Ragdoll.State == ERagdollState::Simulating && Age >= SleepDelay )
+		{
+			Character->GetMesh()->PutAllRigidBodiesToSleep();
+			Ragdoll.State = ERagdollState::Sleeping;
+		}
+		else if ( Ragdoll.State == ERagdollState::Sleeping && Age >= FreezeDelay )
+		{
+			Freeze( Ragdoll );
+		}
+	}
+
+	SET_DWORD_STAT( STAT_SimulatedRagdolls, NumSimulated );
+}
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RagdollSubsystem.generated.h"
+
+class ACharacter;
+class UAnimSequence;
+class UPhysicsAsset;
+
+/**
+ * Budgets death physics. Only MaxSimulatedRagdolls bodies simulate at once; the oldest is frozen in its current pose
+ * when a new one needs the slot, and every ragdoll is put to sleep after SleepDelay and frozen after FreezeDelay.
+ * Deaths far from every local view, or off screen, play a baked animation instead of simulating at all.
+ * Ragdolls are purely cosmetic and client side: only the death itself replicates, never the bodies.
+ */
+UCLASS( config = Game )
+class CAPSTONE_API URagdollSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Plays the death of Character as a ragdoll or, if it is too far away or the budget is spent, as DeathAnimation.*/
+	void StartDeath( ACharacter* Character, UAnimSequence* DeathAnimation, UPhysicsAsset* RagdollPhysicsAsset );
+
+	/** Undoes StartDeath, e.g. because Character was respawned from the pool: its mesh goes back on the capsule and animates again.*/
+	void Revive( ACharacter* Character );
+
+	/** Forgets Character, e.g. because it was destroyed. Frees its simulation slot.*/
+	void RemoveCharacter( ACharacter* Character );
+
+	virtual void Tick( float DeltaTime ) override;
+	virtual TStatId GetStatId() const override;
+
+	FORCEINLINE int32 GetNumSimulated() const { return NumSimulated; }
+
+protected:
+	virtual bool ShouldCreateSubsystem( UObject* Outer ) const override;
+	virtual bool DoesSupportWorldType( const EWorldType::Type WorldType ) const override;
+
+	enum class ERagdollState : uint8
+	{
+		Simulating,
+		Sleeping,
+		Frozen,
+	};
+
+	struct FRagdoll
+	{
+		TWeakObjectPtr<ACharacter> Character;
+		float StartTime = 0.0f;
+		ERagdollState State = ERagdollState::Simulating;
+	};
+
+	/** True if the death is close enough to a local view and visible enough to be worth simulating.*/
+	bool ShouldSimulate( const ACharacter* Character ) const;
+
+	void SimulateRagdoll( ACharacter* Character, UPhysicsAsset* RagdollPhysicsAsset );
+	void Freeze( FRagdoll& Ragdoll );
+
+	/** Frozen ragdolls keep their pose but cost nothing, the oldest simulating one makes room for a new death.*/
+	void FreezeOldestSimulating();
+
+	/** Most ragdolls simulating at the same time.*/
+	UPROPERTY( config )
+	int32 MaxSimulatedRagdolls = 8;
+
+	/** Deaths further than this from every local view play DeathAnimation instead of simulating.*/
+	UPROPERTY( config )
+	float MaxRagdollDistance = 3000.0f;
+
+	/** Seconds a ragdoll simulates before its bodies are put to sleep.*/
+	UPROPERTY( config )
+	float SleepDelay = 3.0f;
+
+	/** Seconds after which a ragdoll is frozen for good and stops counting against the cap.*/
+	UPROPERTY( config )
+	float FreezeDelay = 6.0f;
+
+	// Oldest first
+	TArray<FRagdoll> Ragdolls;
+
+	int32 NumSimulated = 0;
+};
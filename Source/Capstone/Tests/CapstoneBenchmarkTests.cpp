@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneBenchmarks.h"
+
+#include "Engine/World.h"
+#include "Misc/AutomationTest.h"
+#include "Tests/AutomationCommon.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CapstoneBenchmarkTests
+{
+// Per iteration budgets. Times leave room for slow build machines, allocations are what the hot paths promise.
+// A negative budget is not checked, spawning and destroying projectiles is only there to compare the pool against.
+struct FBenchmarkBudget
+{
+	const TCHAR* Name;
+	double MaxMicroseconds;
+	double MaxAllocations;
+};
+
+const FBenchmarkBudget Budgets[] =
+{
+	{ TEXT( "EquipCycling" ), 100.0, 0.0 },
+	{ TEXT( "WeaponOnRep" ), 50.0, 0.0 },
+	{ TEXT( "ProjectileSpawn" ), 1000.0, -1.0 },
+	{ TEXT( "ProjectileDestroy" ), 1000.0, -1.0 },
+	{ TEXT( "ProjectilePoolAcquireRelease" ), 50.0, 0.0 },
+	{ TEXT( "AnimSetVariables" ), 10.0, 0.0 },
+};
+
+constexpr int32 BenchmarkIterations = 1000;
+
+void CheckBudgets( FAutomationTestBase& Test, const TArray<FCapstoneBenchmarkResult>& Results )
+{
+	for ( const FCapstoneBenchmarkResult& Result : Results )
+	{
+		const double PerIteration = 1.0 / FMath::Max( Result.Iterations, 1 );
+		const double Microseconds = Result.TotalMs * 1000.0 * PerIteration;
+		const double Allocations = Result.Allocations * PerIteration;
+		Test.AddInfo( FString::Printf( TEXT( "%s: %.3f us, %.3f allocations per iteration" ), *Result.Name, Microseconds, Allocations ) );
+
+		for ( const FBenchmarkBudget& Budget : Budgets )
+		{
+			if ( Result.Name != Budget.Name ) continue;
+
+			if ( Budget.MaxMicroseconds >= 0.0 && Microseconds > Budget.MaxMicroseconds )
+			{
+				Test.AddError( FString::Printf( TEXT( "%s took %.3f us per iteration, the budget is %.3f us" ), *Result.Name, Microseconds, Budget.MaxMicroseconds ) );
+			}
+
+			if ( Budget.MaxAllocations >= 0.0 && Allocations > Budget.MaxAllocations )
+			{
+				Test.AddError( FString::Printf( TEXT( "%s made %.3f allocations per iteration, the budget is %.3f" ), *Result.Name, Allocations, Budget.MaxAllocations ) );
+			}
+		}
+	}
+}
+}
+
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER( FCapstoneRunBenchmarksCommand, FAutomationTestBase*, Test );
+
+bool FCapstoneRunBenchmarksCommand::Update()
+{
+	using namespace CapstoneBenchmarkTests;
+
+	TArray<FCapstoneBenchmarkResult> Results;
+	if ( !FCapstoneBenchmarks::RunAll( AutomationCommon::GetAnyGameWorld(), BenchmarkIterations, Results ) )
+	{
+		Test->AddError( TEXT( "No game world to run the benchmarks in" ) );
+		return true;
+	}
+
+	CheckBudgets( *Test, Results );
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FCapstoneGameplayBenchmarkTest, "Capstone.Benchmarks.Gameplay", EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter )
+
+bool FCapstoneGameplayBenchmarkTest::RunTest( const FString& Parameters )
+{
+	AutomationOpenMap( TEXT( "/Game/Maps/NetworkTesting" ) );
+
+	// The player's weapon classes stream in after BeginPlay
+	ADD_LATENT_AUTOMATION_COMMAND( FWaitLatentCommand( 2.0f ) );
+	ADD_LATENT_AUTOMATION_COMMAND( FCapstoneRunBenchmarksCommand( this ) );
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FCapstoneAnimBenchmarkTest, "Capstone.Benchmarks.AnimSetVariables", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter )
+
+bool FCapstoneAnimBenchmarkTest::RunTest( const FString& Parameters )
+{
+	using namespace CapstoneBenchmarkTests;
+
+	// Needs no world, so it also runs in the editor
+	CheckBudgets( *this, { FCapstoneBenchmarks::AnimSetVariables( BenchmarkIterations ) } );
+	return true;
+}
+
+#endif
@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneCharacter.h"
+#include "LagCompensationSubsystem.h"
+#include "NetworkProjectile.h"
+#include "PoseHistory.h"
+#include "ProjectileBatchManager.h"
+
+#include "Engine/World.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace CapstoneLagCompensationTests
+{
+// A target strafing sideways at 600 units per second, recorded at 60 Hz for one second like RecordPose does
+constexpr float PoseTickRate = 60.0f;
+constexpr float StrafeSpeed = 600.0f;
+constexpr float RecordedSeconds = 1.0f;
+const FVector StartLocation( 1000.0f, 0.0f, 100.0f );
+const FVector HeadOffset( 0.0f, 0.0f, 70.0f );
+
+FVector GetTargetLocation( const float Time )
+{
+	return StartLocation + FVector( 0.0f, StrafeSpeed * Time, 0.0f );
+}
+
+FPoseHistory MakeStrafingHistory()
+{
+	FPoseHistory History;
+	for ( int32 Tick = 0; Tick <= FMath::RoundToInt( PoseTickRate * RecordedSeconds ); ++Tick )
+	{
+		FPoseSnapshot Snapshot;
+		Snapshot.Time = Tick / PoseTickRate;
+		Snapshot.Location = GetTargetLocation( Snapshot.Time );
+		Snapshot.HeadLocation = Snapshot.Location + HeadOffset;
+		History.Record( Snapshot );
+	}
+	return History;
+}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FCapstonePoseHistoryTest, "Capstone.LagCompensation.PoseHistory", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter )
+
+bool FCapstonePoseHistoryTest::RunTest( const FString& Parameters )
+{
+	using namespace CapstoneLagCompensationTests;
+
+	const FPoseHistory History = MakeStrafingHistory();
+	FPoseSnapshot Pose;
+
+	TestFalse( TEXT( "An empty history has nothing to sample" ), FPoseHistory().Sample( 0.5f, Pose ) );
+
+	// Halfway between two ticks the pose is interpolated
+	TestTrue( TEXT( "Sample inside the history" ), History.Sample( 0.5f + 0.5f / PoseTickRate, Pose ) );
+	TestEqual( TEXT( "Interpolated location" ), Pose.Location, GetTargetLocation( 0.5f + 0.5f / PoseTickRate ), 0.1f );
+	TestEqual( TEXT( "Interpolated head" ), Pose.HeadLocation, GetTargetLocation( 0.5f + 0.5f / PoseTickRate ) + HeadOffset, 0.1f );
+
+	TestTrue( TEXT( "Sample after the newest snapshot" ), History.Sample( RecordedSeconds + 1.0f, Pose ) );
+	TestEqual( TEXT( "Newest snapshot is used for future times" ), Pose.Location, GetTargetLocation( RecordedSeconds ), 0.1f );
+
+	TestTrue( TEXT( "Sample before the oldest snapshot" ), History.Sample( -1.0f, Pose ) );
+	TestEqual( TEXT( "Oldest snapshot is used for past times" ), Pose.Location, GetTargetLocation( 0.0f ), 0.1f );
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FCapstoneLagCompensationTest, "Capstone.LagCompensation.RewoundHits", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter )
+
+bool FCapstoneLagCompensationTest::RunTest( const FString& Parameters )
+{
+	using namespace CapstoneLagCompensationTests;
+
+	// A bare world is enough, SweepRewound only looks at the registered characters and their pose history
+	UWorld* World = UWorld::CreateWorld( EWorldType::Game, false );
+	ULagCompensationSubsystem* LagCompensation = World ? World->GetSubsystem<ULagCompensationSubsystem>() : nullptr;
+	if ( !TestNotNull( TEXT( "Lag compensation subsystem" ), LagCompensation ) ) return false;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ACapstoneCharacter* Target = World->SpawnActor<ACapstoneCharacter>( ACapstoneCharacter::StaticClass(), GetTargetLocation( RecordedSeconds ), FRotator::ZeroRotator, SpawnParameters );
+
+	if ( TestNotNull( TEXT( "Target character" ), Target ) )
+	{
+		Target->PoseHistory = MakeStrafingHistory();
+		LagCompensation->RegisterCharacter( Target );
+
+		TestEqual( TEXT( "Rewinds are clamped" ), LagCompensation->ClampRewind( 10.0f ), LagCompensation->GetMaxRewindSeconds() );
+
+		// A shot fired at where the shooter saw the target, from the side the target strafes across
+		for ( const int32 LatencyMs : { 0, 100, 400 } )
+		{
+			const float ShotTime = RecordedSeconds - LatencyMs / 1000.0f;
+			const FVector Seen = GetTargetLocation( ShotTime );
+			const FVector Start( 0.0f, Seen.Y, Seen.Z );
+			const FVector End( 2000.0f, Seen.Y, Seen.Z );
+
+			FHitResult Hit;
+			const bool bRewoundHit = LagCompensation->SweepRewound( Start, End, 0.0f, ShotTime, nullptr, Hit );
+			TestTrue( FString::Printf( TEXT( "%d ms: hits the rewound pose" ), LatencyMs ), bRewoundHit );
+			TestTrue( FString::Printf( TEXT( "%d ms: hits the target" ), LatencyMs ), bRewoundHit && Hit.GetActor() == Target );
+
+			// The target has moved on by more than its capsule radius, only the rewind makes these hits count
+			if ( LatencyMs > 0 )
+			{
+				TestFalse( FString::Printf( TEXT( "%d ms: misses the current pose" ), LatencyMs ), LagCompensation->SweepRewound( Start, End, 0.0f, RecordedSeconds, nullptr, Hit ) );
+
+				const FVector Current = GetTargetLocation( RecordedSeconds );
+				TestFalse( FString::Printf( TEXT( "%d ms: a shot at the current pose misses when rewound" ), LatencyMs ),
+					LagCompensation->SweepRewound( FVector( 0.0f, Current.Y, Current.Z ), FVector( 2000.0f, Current.Y, Current.Z ), 0.0f, ShotTime, nullptr, Hit ) );
+			}
+		}
+
+		// The head is tested before the body
+		const float HeadShotTime = RecordedSeconds - 0.4f;
+		const FVector Head = GetTargetLocation( HeadShotTime ) + HeadOffset;
+		FHitResult HeadHit;
+		TestTrue( TEXT( "400 ms: headshot hits" ), LagCompensation->SweepRewound( FVector( 0.0f, Head.Y, Head.Z ), FVector( 2000.0f, Head.Y, Head.Z ), 0.0f, HeadShotTime, nullptr, HeadHit ) );
+		TestTrue( TEXT( "400 ms: headshot bone" ), HeadHit.BoneName == FName( "head" ) );
+
+		// Corpses never stop shots
+		const FVector DeadLocation = GetTargetLocation( RecordedSeconds );
+		FHitResult DeadHit;
+		Target->CurrentHealth = 0.0f;
+		TestFalse( TEXT( "Dead targets are skipped" ), LagCompensation->SweepRewound( FVector( 0.0f, DeadLocation.Y, DeadLocation.Z ), FVector( 2000.0f, DeadLocation.Y, DeadLocation.Z ), 0.0f, RecordedSeconds, nullptr, DeadHit ) );
+
+		LagCompensation->UnregisterCharacter( Target );
+	}
+
+	World->DestroyWorld( false );
+	World->RemoveFromRoot();
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FCapstoneHandleFireTest, "Capstone.LagCompensation.HandleFire", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter )
+
+bool FCapstoneHandleFireTest::RunTest( const FString& Parameters )
+{
+	using namespace CapstoneLagCompensationTests;
+
+	UWorld* World = UWorld::CreateWorld( EWorldType::Game, false );
+	ULagCompensationSubsystem* LagCompensation = World ? World->GetSubsystem<ULagCompensationSubsystem>() : nullptr;
+	AProjectileBatchManager* ProjectileManager = World ? AProjectileBatchManager::Get( World ) : nullptr;
+	if ( !TestNotNull( TEXT( "Lag compensation subsystem" ), LagCompensation ) || !TestNotNull( TEXT( "Projectile batch manager" ), ProjectileManager ) ) return false;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ACapstoneCharacter* Target = World->SpawnActor<ACapstoneCharacter>( ACapstoneCharacter::StaticClass(), GetTargetLocation( RecordedSeconds ), FRotator::ZeroRotator, SpawnParameters );
+	ACapstoneCharacter* Shooter = World->SpawnActor<ACapstoneCharacter>( ACapstoneCharacter::StaticClass(), FVector::ZeroVector, FRotator::ZeroRotator, SpawnParameters );
+
+	if ( TestNotNull( TEXT( "Target character" ), Target ) && TestNotNull( TEXT( "Shooter character" ), Shooter ) )
+	{
+		Target->PoseHistory = MakeStrafingHistory();
+		LagCompensation->RegisterCharacter( Target );
+
+		// Unarmed, so shots go through the batched projectile path which keeps the rewind of every shot
+		Shooter->ProjectileClass = ANetworkProjectile::StaticClass();
+		Shooter->bUseBatchedProjectiles = true;
+		Shooter->FireRate = 0.1f;
+
+		const auto Fire = [Shooter]( const float ClientTime, const float ViewTime )
+		{
+			FPredictedShot Shot;
+			Shot.PredictionKey = ++Shooter->LastPredictionKey;
+			Shot.Direction = FVector::ForwardVector;
+			Shot.ClientTime = ClientTime;
+			Shot.ViewTime = ViewTime;
+			Shooter->HandleFire_Implementation( { Shot } );
+		};
+
+		// Fired 100 ms ago at a target drawn with the shooter's movement smoothing on top of that
+		World->TimeSeconds = RecordedSeconds;
+		const float ClientTime = RecordedSeconds - 0.1f;
+		const float ViewTime = ClientTime - Shooter->GetRemoteViewDelay();
+		Fire( ClientTime, ViewTime );
+
+		if ( TestEqual( TEXT( "Shot is accepted" ), ProjectileManager->RewindOffsets.Num(), 1 ) )
+		{
+			const float Rewind = ProjectileManager->RewindOffsets[0];
+			TestEqual( TEXT( "Rewinds to the pose the client was looking at" ), Rewind, RecordedSeconds - ViewTime, KINDA_SMALL_NUMBER );
+			TestTrue( TEXT( "Rewinds further than the latency alone" ), Shooter->GetRemoteViewDelay() <= 0.0f || Rewind > RecordedSeconds - ClientTime );
+
+			// The rewound time finds the target where the client saw it
+			const FVector Seen = GetTargetLocation( RecordedSeconds - Rewind );
+			FHitResult Hit;
+			TestTrue( TEXT( "Hits the pose the client saw" ), LagCompensation->SweepRewound( FVector( 0.0f, Seen.Y, Seen.Z ), FVector( 2000.0f, Seen.Y, Seen.Z ), 0.0f, RecordedSeconds - Rewind, nullptr, Hit ) && Hit.GetActor() == Target );
+		}
+
+		// Faster than the fire rate allows
+		World->TimeSeconds = RecordedSeconds + 0.02f;
+		Fire( ClientTime + 0.02f, ViewTime + 0.02f );
+		TestEqual( TEXT( "Shot too soon is rejected" ), ProjectileManager->RewindOffsets.Num(), 1 );
+
+		// A client claiming to have seen poses from long ago is held to the rewind window
+		World->TimeSeconds = RecordedSeconds + 0.2f;
+		Fire( RecordedSeconds + 0.1f, 0.0f );
+		if ( TestEqual( TEXT( "Back-dated view is accepted" ), ProjectileManager->RewindOffsets.Num(), 2 ) )
+		{
+			TestEqual( TEXT( "Back-dated view is clamped" ), ProjectileManager->RewindOffsets[1], LagCompensation->GetMaxRewindSeconds(), KINDA_SMALL_NUMBER );
+		}
+
+		LagCompensation->UnregisterCharacter( Target );
+	}
+
+	World->DestroyWorld( false );
+	World->RemoveFromRoot();
+	return true;
+}
+
+#endif
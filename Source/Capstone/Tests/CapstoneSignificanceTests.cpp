@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "CapstoneSignificanceManager.h"
+
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST( FCapstoneSignificanceBudgetTest, "Capstone.Significance.MeasuredBudget", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter )
+
+bool FCapstoneSignificanceBudgetTest::RunTest( const FString& Parameters )
+{
+	// Without a world the manager never ticks, the test feeds it measurements by hand
+	UCapstoneSignificanceManager* Manager = NewObject<UCapstoneSignificanceManager>( GetTransientPackage() );
+	Manager->AnimBudgetMs = 2.0f;
+	Manager->FullTierCostMs = 0.1f;
+	Manager->CostSmoothing = 0.5f;
+
+	TestEqual( TEXT( "The config estimate is used before anything was measured" ), Manager->GetTierCost( ECharacterAnimTier::Full ), 0.1f );
+
+	// Characters turn out to be five times as expensive as estimated
+	FFluidAnimUpdateCost Cost;
+	Cost.IKMs = 2.0;
+	Cost.IKUpdates = 4;
+	Cost.BaseMs = 0.6;
+	Cost.BaseUpdates = 2;
+	Manager->RecordAnimCost( Cost );
+
+	TestEqual( TEXT( "The first measurement replaces the estimate" ), Manager->GetTierCost( ECharacterAnimTier::Full ), 0.5f, 0.001f );
+	TestEqual( TEXT( "Measured total" ), Manager->GetMeasuredAnimMs(), 2.6f, 0.001f );
+	TestTrue( TEXT( "Reduced tiers use the update cost without IK" ), Manager->GetTierCost( ECharacterAnimTier::Reduced ) <= 0.3f + KINDA_SMALL_NUMBER );
+
+	// Later measurements are smoothed in
+	Cost.IKMs = 4.0;
+	Manager->RecordAnimCost( Cost );
+	TestEqual( TEXT( "Smoothed full tier cost" ), Manager->GetTierCost( ECharacterAnimTier::Full ), 0.75f, 0.001f );
+
+	// Twenty characters that all want the full tier never spend more than the budget
+	float SpentMs = 0.0f;
+	int32 NumFull = 0;
+	for ( int32 Index = 0; Index < 20; ++Index )
+	{
+		const ECharacterAnimTier Tier = Manager->FitToBudget( ECharacterAnimTier::Full, SpentMs );
+		SpentMs += Manager->GetTierCost( Tier );
+		if ( Tier == ECharacterAnimTier::Full ) NumFull++;
+	}
+
+	TestTrue( TEXT( "Budget is never exceeded" ), SpentMs <= Manager->AnimBudgetMs + KINDA_SMALL_NUMBER );
+	TestEqual( TEXT( "Only as many full tiers as the measured cost allows" ), NumFull, 2 );
+
+	Manager->MarkAsGarbage();
+	return true;
+}
+
+#endif
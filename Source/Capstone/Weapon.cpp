@@ -2,20 +2,43 @@
 
 
 #include "Weapon.h"
+#include "CapstoneCharacter.h"
+#include "CapstoneNetSerialization.h"
+#include "AggregatedTickSubsystem.h"
+#include "NetSchedulerSubsystem.h"
+
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+bool FWeaponCustomization::NetSerialize( FArchive& Ar, UPackageMap* Map, bool& bOutSuccess )
+{
+	CapstoneNetSerialization::SerializeQuantizedTransform( Ar, PlacementOffset, FTransform::Identity );
+	CapstoneNetSerialization::SerializeQuantizedTransform( Ar, SightsOffset, FTransform::Identity );
+	CapstoneNetSerialization::SerializeQuantizedFloat( Ar, AimOffsetDelta, 0.0f );
+
+	bOutSuccess = true;
+	return true;
+}
 
 // Sets default values
 AWeapon::AWeapon()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+	// Per-frame work like recoil recovery runs batched in UAggregatedTickSubsystem
+	PrimaryActorTick.bCanEverTick = false;
 
 	SetReplicates( true );
 
+	// Most weapons sit holstered, they replicate once when spawned and then only when flushed or equipped
+	NetDormancy = DORM_DormantAll;
+
 	Root = CreateDefaultSubobject<USceneComponent>( TEXT( "Root" ) );
 	RootComponent = Root;
 
 	Mesh = CreateDefaultSubobject<USkeletalMeshComponent>( TEXT( "Mesh" ) );
 	Mesh->SetupAttachment( Root );
+
+	// Holstered weapons stay attached but hidden, they should not pay for a pose nobody sees
+	Mesh->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
 }
 
 // Called when the game starts or when spawned
@@ -24,4 +47,78 @@ void AWeapon::BeginPlay()
 	Super::BeginPlay();
 	
 	if( !CurrentOwner ) Mesh->SetVisibility( false );
+
+	if ( HasAuthority() )
+	{
+		if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->RegisterWeapon( this );
+	}
+}
+
+void AWeapon::EndPlay( const EEndPlayReason::Type EndPlayReason )
+{
+	if ( UAggregatedTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UAggregatedTickSubsystem>() ) TickSubsystem->UnregisterWeapon( this );
+	if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->UnregisterWeapon( this );
+
+	Super::EndPlay( EndPlayReason );
+}
+
+void AWeapon::AddRecoil()
+{
+	Recoil += RecoilKick;
+
+	if ( UAggregatedTickSubsystem* TickSubsystem = GetWorld()->GetSubsystem<UAggregatedTickSubsystem>() ) TickSubsystem->RegisterRecoil( this );
+	else Recoil = FRotator::ZeroRotator;
+}
+
+bool AWeapon::RecoverRecoil( const float DeltaTime )
+{
+	Recoil = FMath::RInterpTo( Recoil, FRotator::ZeroRotator, DeltaTime, RecoilRecoverySpeed );
+	if ( !Recoil.IsNearlyZero( 0.01f ) ) return true;
+
+	Recoil = FRotator::ZeroRotator;
+	return false;
+}
+
+void AWeapon::GetLifetimeReplicatedProps( TArray<FLifetimeProperty>& OutLifetimeProps ) const
+{
+	Super::GetLifetimeReplicatedProps( OutLifetimeProps );
+
+	FDoRepLifetimeParams PushParams;
+	PushParams.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST( AWeapon, Customization, PushParams );
+}
+
+void AWeapon::SetCustomization( const FWeaponCustomization& NewCustomization )
+{
+	if ( !HasAuthority() ) return;
+
+	Customization = NewCustomization;
+	MARK_PROPERTY_DIRTY_FROM_NAME( AWeapon, Customization, this );
+
+	if ( UNetSchedulerSubsystem* NetScheduler = GetWorld()->GetSubsystem<UNetSchedulerSubsystem>() ) NetScheduler->WakeWeapon( this );
+
+	ApplyCustomization();
+}
+
+void AWeapon::OnRep_Customization()
+{
+	ApplyCustomization();
+}
+
+void AWeapon::ApplyCustomization()
+{
+	const AWeapon* Defaults = GetClass()->GetDefaultObject<AWeapon>();
+	PlacementTransform = Customization.PlacementOffset * Defaults->PlacementTransform;
+	IKProperties.CustomOffsetTransform = Customization.SightsOffset * Defaults->IKProperties.CustomOffsetTransform;
+	IKProperties.AimOffset = Defaults->IKProperties.AimOffset + Customization.AimOffsetDelta;
+
+	// An attached weapon moves to its new placement and tells the anim instance its sights moved with it
+	if ( CurrentOwner && GetRootComponent()->GetAttachParent() )
+	{
+		SetActorRelativeTransform( PlacementTransform );
+		HandToSightsTransform = GetSightsWorldTransform().GetRelativeTransform( GetRootComponent()->GetAttachParent()->GetSocketTransform( GetAttachParentSocketName() ) );
+
+		if ( CurrentOwner->CurrentWeapon == this && CurrentOwner->CurrentWeaponChangeDelegate.IsBound() ) CurrentOwner->CurrentWeaponChangeDelegate.Broadcast( this, this );
+	}
 }
\ No newline at end of file
@@ -6,6 +6,14 @@
 #include "GameFramework/Actor.h"
 #include "Weapon.generated.h"
 
+// How a weapon's shots travel
+UENUM( BlueprintType )
+enum class EWeaponFireMode : uint8
+{
+	Projectile,	// Fires the owner's ProjectileClass
+	HitScan,	// Resolved instantly with async line traces by UHitScanSubsystem, no projectile is spawned
+};
+
 USTRUCT(BlueprintType)
 struct FIKProperties {
 	GENERATED_BODY()
@@ -20,6 +28,34 @@ struct FIKProperties {
 	FTransform CustomOffsetTransform;
 };
 
+// A player's adjustments to a weapon, applied on top of the weapon class defaults
+USTRUCT(BlueprintType)
+struct FWeaponCustomization
+{
+	GENERATED_BODY()
+
+	/** Applied on top of the class PlacementTransform.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite )
+	FTransform PlacementOffset;
+
+	/** Applied on top of the class IKProperties.CustomOffsetTransform.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite )
+	FTransform SightsOffset;
+
+	/** Added to the class IKProperties.AimOffset.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite )
+	float AimOffsetDelta = 0.0f;
+
+	/** Everything is an offset from identity, so an untouched weapon costs three bits per transform.*/
+	bool NetSerialize( FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess );
+};
+
+template<>
+struct TStructOpsTypeTraits<FWeaponCustomization> : public TStructOpsTypeTraitsBase2<FWeaponCustomization>
+{
+	enum { WithNetSerializer = true };
+};
+
 UCLASS(Abstract)
 class CAPSTONE_API AWeapon : public AActor
 {
@@ -32,6 +68,32 @@ public:
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay( const EEndPlayReason::Type EndPlayReason ) override;
+
+	UFUNCTION()
+	void OnRep_Customization();
+
+	/** Rebuilds PlacementTransform and IKProperties from the class defaults and Customization.*/
+	void ApplyCustomization();
+
+	/** The owning player's adjustments. Only replicates if the player changed something.*/
+	UPROPERTY( ReplicatedUsing = OnRep_Customization )
+	FWeaponCustomization Customization;
+
+public:
+	void GetLifetimeReplicatedProps( TArray<FLifetimeProperty>& OutLifetimeProps ) const override;
+
+	/** Sets the player's adjustments to this weapon. Server only.*/
+	UFUNCTION( BlueprintCallable, BlueprintAuthorityOnly, Category = "Configurations" )
+	void SetCustomization( const FWeaponCustomization& NewCustomization );
+
+	FORCEINLINE const FWeaponCustomization& GetCustomization() const { return Customization; }
+
+	/** Kicks the weapon by RecoilKick. Cosmetic, only the shooter's machine calls this.*/
+	void AddRecoil();
+
+	/** Called by UAggregatedTickSubsystem while Recoil is not zero. Returns false once it has settled.*/
+	bool RecoverRecoil( const float DeltaTime );
 
 public:
 	UPROPERTY(VisibleAnywhere, BlueprintReadWrite, Category="Components")
@@ -49,6 +111,56 @@ public:
 	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Configurations" )
 	FTransform PlacementTransform;
 
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing" )
+	EWeaponFireMode FireMode = EWeaponFireMode::Projectile;
+
+	/** Length of every hit-scan trace.*/
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing", meta = ( EditCondition = "FireMode == EWeaponFireMode::HitScan" ) )
+	float HitScanRange = 10000.0f;
+
+	/** Damage of each pellet that hits.*/
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing", meta = ( EditCondition = "FireMode == EWeaponFireMode::HitScan" ) )
+	float HitScanDamage = 10.0f;
+
+	/** Traces per shot, more than one makes a shotgun.*/
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing", meta = ( ClampMin = "1", EditCondition = "FireMode == EWeaponFireMode::HitScan" ) )
+	int32 PelletCount = 1;
+
+	/** Half angle of the cone pellets spread in, in degrees.*/
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing", meta = ( EditCondition = "FireMode == EWeaponFireMode::HitScan" ) )
+	float PelletSpread = 0.0f;
+
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing", meta = ( EditCondition = "FireMode == EWeaponFireMode::HitScan" ) )
+	TSubclassOf<class UDamageType> HitScanDamageType;
+
+	/** Beam drawn from the muzzle to where each pellet stopped.*/
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing", meta = ( EditCondition = "FireMode == EWeaponFireMode::HitScan" ) )
+	class UParticleSystem* TracerEffect;
+
+	/** Vector parameter of TracerEffect the beam end is written to.*/
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing", meta = ( EditCondition = "FireMode == EWeaponFireMode::HitScan" ) )
+	FName TracerEndParameter = FName( "ShockBeamEnd" );
+
+	/** Spawned where a pellet hits something.*/
+	UPROPERTY( EditAnywhere, BlueprintReadOnly, Category = "Firing", meta = ( EditCondition = "FireMode == EWeaponFireMode::HitScan" ) )
+	class UParticleSystem* HitScanImpactEffect;
+
+	/** Added to Recoil for every shot.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Configurations" )
+	FRotator RecoilKick = FRotator( 1.5f, 0.0f, 0.0f );
+
+	/** How fast Recoil interpolates back to zero.*/
+	UPROPERTY( EditAnywhere, BlueprintReadWrite, Category = "Configurations" )
+	float RecoilRecoverySpeed = 10.0f;
+
+	/** Current recoil, read by the anim instance.*/
+	UPROPERTY( VisibleInstanceOnly, BlueprintReadOnly, Category = "State" )
+	FRotator Recoil = FRotator::ZeroRotator;
+
+	/** Sights relative to the owner's weapon socket. Computed once when the weapon is attached, it never changes after.*/
+	UPROPERTY( VisibleInstanceOnly, BlueprintReadOnly, Category = "IK" )
+	FTransform HandToSightsTransform;
+
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category="IK")
 	FTransform GetSightsWorldTransform() const;
 	virtual FORCEINLINE	FTransform GetSightsWorldTransform_Implementation() const { return Mesh->GetSocketTransform( FName( "Aim" ) ); }